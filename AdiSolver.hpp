@@ -0,0 +1,746 @@
+/*
+AdiSolver.hpp
+
+Two-Dimensional ADI Finite-Difference Solver (Douglas, Craig-Sneyd, Hundsdorfer-Verwer)
+
+Overview:
+---------
+`AdiSolver2D` integrates, backwards in tau = T - t,
+
+    u_tau = axx u_xx + ayy u_yy + axy u_xy + bx u_x + by u_y - r u
+
+on a tensor grid of two non-uniform `Grid1D` axes. The operator is split as
+A = A0 + A1 + A2 (mixed, x and y parts, -r u shared equally by A1 and A2) and
+advanced with the ADI schemes of In 't Hout and Foulon:
+
+- AdiScheme::Douglas            : Y0 = U + dt A U, Yk = Y(k-1) + theta dt Ak (Yk - U).
+                                  Second order for theta = 1/2 without mixed terms.
+- AdiScheme::CraigSneyd         : Douglas, then a mixed-term correction
+                                  Y0~ = Y0 + dt/2 A0 (Y2 - U) and a second pair of
+                                  implicit sweeps. Second order, theta = 1/2.
+- AdiScheme::HundsdorferVerwer  : Douglas, then Y0~ = Y0 + dt/2 A (Y2 - U) and
+                                  sweeps around Y2. Second order and more robust,
+                                  theta = 1/2 + sqrt(3)/6.
+
+The first time step is replaced by two half steps of Douglas with theta = 1
+(Rannacher damping of the payoff kink).
+
+Discretization:
+---------------
+Second-order central differences on the non-uniform grids (three-point first and
+second derivatives, the tensor product of first-derivative stencils for u_xy).
+Grid edges are "natural": the equation is applied with u_xx = 0 (u_yy = 0), a
+one-sided first derivative and no mixed term, which is exact where the
+coefficients vanish (S = 0, v = 0) and the usual linearity condition far out.
+Any edge can instead be Dirichlet with a value g(x, y, tau), e.g. a knock-out
+barrier paying a rebate.
+
+Performance:
+------------
+Coefficients and the tridiagonal factorizations are computed once per run. The
+x sweeps solve one contiguous grid line at a time; the y sweeps run the Thomas
+recursion over all x lines at once, so the inner loop is contiguous and
+vectorizes. With threads > 1, every operator application and sweep is split
+over grid lines among a team of workers started once per Solve(), which meet at
+a barrier per phase (as SlvCalibrator's BlockTeam). Each line is computed the
+same way whatever the split, so the result does not depend on the thread count.
+
+Pricers:
+--------
+- HestonAdiPricer : (S, v) grid, S concentrated around the spot, v around zero.
+                    Price(payoff) and PriceUpAndOut(payoff, barrier, rebate) take
+                    the payoff policies of the MC consumers (`OptionData::payoffPolicy()`,
+                    VanillaPayoff, ...) and the (barrier, rebate) of
+                    BarrierBatchConsumer, monitored continuously here.
+- TwoAssetAdiPricer: two correlated GBMs, (S1, S2) grid, payoffs of (S1, S2)
+                    such as SpreadPayoff.
+
+Usage:
+------
+```cpp
+auto heston = std::make_shared<HestonModel>(S0, v0, r, q, kappa, theta, xi, rho, T);
+HestonAdiPricer pde(heston, 100, 50, 50, AdiScheme::HundsdorferVerwer);
+double call = pde.Price(VanillaPayoff(K, 1));
+double uoc = pde.PriceUpAndOut(VanillaPayoff(K, 1), 130.0);
+
+TwoAssetAdiPricer spread(S1, S2, vol1, vol2, corr, r, q1, q2, T, 80, 80, 50);
+double exchange = spread.Price(SpreadPayoff(0.0, 1));
+```
+
+*/
+
+#ifndef AdiSolver_HPP
+#define AdiSolver_HPP
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#include <chrono>
+
+#include "PayoffPolicies.hpp"
+#include "HestonModel.hpp"
+
+class Grid1D
+{
+private:
+    std::vector<double> nodes;
+
+public:
+    explicit Grid1D(std::vector<double> points) : nodes(std::move(points))
+    {
+        if (nodes.size() < 3 || !std::is_sorted(nodes.begin(), nodes.end()))
+            throw std::invalid_argument("Grid1D: requires at least 3 increasing nodes");
+    }
+
+    static Grid1D Uniform(double lo, double hi, int n)
+    {
+        std::vector<double> x(n);
+        for (int i = 0; i < n; ++i)
+            x[i] = lo + (hi - lo) * i / (n - 1.0);
+        return Grid1D(std::move(x));
+    }
+
+    // x = c + d sinh(xi), xi uniform: spacing about d / (n / asinh range) near c, growing away from it
+    static Grid1D Concentrated(double lo, double hi, int n, double centre, double d)
+    {
+        double a = std::asinh((lo - centre) / d), b = std::asinh((hi - centre) / d);
+        std::vector<double> x(n);
+        for (int i = 0; i < n; ++i)
+            x[i] = centre + d * std::sinh(a + (b - a) * i / (n - 1.0));
+        x.front() = lo;
+        x.back() = hi;
+        return Grid1D(std::move(x));
+    }
+
+    // Moves the nearest interior node onto `value`, so that prices there need no interpolation
+    Grid1D WithNode(double value) const
+    {
+        std::vector<double> x(nodes);
+        std::size_t i = std::upper_bound(x.begin(), x.end(), value) - x.begin();
+        if (i == 0 || i >= x.size())
+            return *this;
+        std::size_t j = (i > 1 && value - x[i - 1] < x[i] - value) ? i - 1 : i;
+        j = std::min(std::max<std::size_t>(j, 1), x.size() - 2);
+        x[j] = value;
+        return Grid1D(std::move(x));
+    }
+
+    std::size_t Size() const { return nodes.size(); }
+    double operator[](std::size_t i) const { return nodes[i]; }
+    const std::vector<double>& Nodes() const { return nodes; }
+};
+
+enum class AdiScheme { Douglas, CraigSneyd, HundsdorferVerwer };
+
+enum class AdiSide { XLower, XUpper, YLower, YUpper };
+
+struct AdiOperator2D
+{ // u_tau = axx u_xx + ayy u_yy + axy u_xy + bx u_x + by u_y - rate u
+    std::function<double(double, double)> axx, ayy, axy, bx, by;
+    double rate = 0.0;
+};
+
+class AdiSolver2D
+{
+private:
+    Grid1D gx, gy;
+    std::size_t nx, ny;
+    double rate;
+    int threads;
+
+    // Three-point operators: A1 couples p -/+ 1, A2 couples p -/+ nx
+    std::vector<double> l1, d1, u1, l2, d2, u2;
+    std::vector<double> mixed;                  // axy at interior nodes, 0 elsewhere
+    std::vector<double> fdx, fdy;               // First-derivative stencils, 3 per node of each axis
+    std::vector<unsigned char> fixed;           // Dirichlet nodes
+    std::vector<std::function<double(double, double, double)>> dirichlet; // Per AdiSide, empty == natural
+
+    struct Factorization
+    { // Thomas coefficients of (I - w A) for one direction: a, c' and 1 / m per node
+        double w = -1.0;
+        std::vector<double> a, cp, invM;
+    };
+    Factorization f1, f2;
+    double elapsed = 0.0;
+
+    // Central first/second derivative weights at node i of g (h-, h+ spacings)
+    static void Stencils(const Grid1D& g, std::size_t i, double* first, double* second)
+    {
+        double hm = g[i] - g[i - 1], hp = g[i + 1] - g[i];
+        first[0] = -hp / (hm * (hm + hp));
+        first[1] = (hp - hm) / (hm * hp);
+        first[2] = hm / (hp * (hm + hp));
+        second[0] = 2.0 / (hm * (hm + hp));
+        second[1] = -2.0 / (hm * hp);
+        second[2] = 2.0 / (hp * (hm + hp));
+    }
+
+    // Worker threads kept for one Solve(). Run() gives member t the contiguous lines
+    // [count t / n, count (t + 1) / n) of a phase, n = min(members, count); the team meets
+    // at a barrier before and after each phase.
+    class LineTeam
+    {
+    private:
+        std::function<void(std::size_t, std::size_t)> task;
+        std::size_t count = 0;
+        std::mutex guard;
+        std::condition_variable arrivedAll;
+        int members, arrived = 0;
+        unsigned long generation = 0;
+        bool done = false;
+        std::vector<std::thread> pool;
+
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(guard);
+            unsigned long gen = generation;
+            if (++arrived == members)
+            {
+                arrived = 0;
+                ++generation;
+                arrivedAll.notify_all();
+            }
+            else
+                arrivedAll.wait(lock, [&]() { return generation != gen; });
+        }
+
+        void Work(int t)
+        {
+            std::size_t n = std::min(static_cast<std::size_t>(members), count);
+            if (static_cast<std::size_t>(t) < n)
+                task(count * t / n, count * (t + 1) / n);
+        }
+
+    public:
+        explicit LineTeam(int threads) : members(std::max(1, threads))
+        {
+            for (int t = 1; t < members; ++t)
+                pool.emplace_back([this, t]() {
+                    for (;;)
+                    {
+                        Wait();
+                        if (done)
+                            return;
+                        Work(t);
+                        Wait();
+                    }
+                });
+        }
+
+        LineTeam(const LineTeam&) = delete;
+        LineTeam& operator=(const LineTeam&) = delete;
+
+        ~LineTeam()
+        {
+            done = true;
+            Wait();
+            for (auto& th : pool)
+                th.join();
+        }
+
+        void Run(std::size_t lines, std::function<void(std::size_t, std::size_t)> fn)
+        {
+            task = std::move(fn);
+            count = lines;
+            Wait();
+            Work(0);
+            Wait();
+        }
+    };
+    std::unique_ptr<LineTeam> team;             // Alive during Solve() when threads > 1
+
+    template <class F>
+    void ParallelFor(std::size_t count, F fn) const
+    { // fn(begin, end) over [0, count), split into one contiguous range per team member
+        if (!team || count < 2)
+        {
+            fn(std::size_t(0), count);
+            return;
+        }
+        team->Run(count, fn);
+    }
+
+    void Build(const AdiOperator2D& op)
+    {
+        std::size_t N = nx * ny;
+        for (auto* v : { &l1, &d1, &u1, &l2, &d2, &u2, &mixed })
+            v->assign(N, 0.0);
+        fdx.assign(3 * nx, 0.0);
+        fdy.assign(3 * ny, 0.0);
+        double s2[3];
+        for (std::size_t i = 1; i + 1 < nx; ++i)
+            Stencils(gx, i, &fdx[3 * i], s2);
+        for (std::size_t j = 1; j + 1 < ny; ++j)
+            Stencils(gy, j, &fdy[3 * j], s2);
+
+        for (std::size_t j = 0; j < ny; ++j)
+        {
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                std::size_t p = i + nx * j;
+                double x = gx[i], y = gy[j];
+                double first[3], second[3];
+
+                // x direction
+                double a = op.axx(x, y), b = op.bx(x, y);
+                if (i == 0)
+                {
+                    double h = gx[1] - gx[0];
+                    d1[p] = -b / h;
+                    u1[p] = b / h;
+                }
+                else if (i + 1 == nx)
+                {
+                    double h = gx[i] - gx[i - 1];
+                    l1[p] = -b / h;
+                    d1[p] = b / h;
+                }
+                else
+                {
+                    Stencils(gx, i, first, second);
+                    l1[p] = a * second[0] + b * first[0];
+                    d1[p] = a * second[1] + b * first[1];
+                    u1[p] = a * second[2] + b * first[2];
+                }
+                d1[p] -= 0.5 * rate;
+
+                // y direction
+                a = op.ayy(x, y);
+                b = op.by(x, y);
+                if (j == 0)
+                {
+                    double h = gy[1] - gy[0];
+                    d2[p] = -b / h;
+                    u2[p] = b / h;
+                }
+                else if (j + 1 == ny)
+                {
+                    double h = gy[j] - gy[j - 1];
+                    l2[p] = -b / h;
+                    d2[p] = b / h;
+                }
+                else
+                {
+                    Stencils(gy, j, first, second);
+                    l2[p] = a * second[0] + b * first[0];
+                    d2[p] = a * second[1] + b * first[1];
+                    u2[p] = a * second[2] + b * first[2];
+                }
+                d2[p] -= 0.5 * rate;
+
+                if (i > 0 && i + 1 < nx && j > 0 && j + 1 < ny)
+                    mixed[p] = op.axy(x, y);
+            }
+        }
+    }
+
+    void MarkFixed()
+    {
+        fixed.assign(nx * ny, 0);
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                bool f = (i == 0 && dirichlet[0]) || (i + 1 == nx && dirichlet[1])
+                    || (j == 0 && dirichlet[2]) || (j + 1 == ny && dirichlet[3]);
+                fixed[i + nx * j] = f ? 1 : 0;
+            }
+    }
+
+    void SetBoundary(std::vector<double>& U, double tau) const
+    {
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                std::size_t p = i + nx * j;
+                if (!fixed[p])
+                    continue;
+                int side = (i == 0 && dirichlet[0]) ? 0 : (i + 1 == nx && dirichlet[1]) ? 1 : (j == 0 && dirichlet[2]) ? 2 : 3;
+                U[p] = dirichlet[side](gx[i], gy[j], tau);
+            }
+    }
+
+    void Factor(Factorization& f, double w, const std::vector<double>& l, const std::vector<double>& d,
+        const std::vector<double>& u, bool xDirection) const
+    {
+        if (f.w == w)
+            return;
+        std::size_t N = nx * ny;
+        f.w = w;
+        f.a.assign(N, 0.0);
+        f.cp.assign(N, 0.0);
+        f.invM.assign(N, 0.0);
+        std::size_t stride = xDirection ? 1 : nx;
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i)
+            {
+                std::size_t p = i + nx * j;
+                bool first = xDirection ? (i == 0) : (j == 0);
+                double a = fixed[p] ? 0.0 : -w * l[p];
+                double b = fixed[p] ? 1.0 : 1.0 - w * d[p];
+                double c = fixed[p] ? 0.0 : -w * u[p];
+                double m = first ? b : b - a * f.cp[p - stride];
+                f.a[p] = a;
+                f.invM[p] = 1.0 / m;
+                f.cp[p] = c / m;
+            }
+    }
+
+    // out = A1 U (x part), A2 U (y part), A0 U (mixed); fixed rows are zero
+    void ApplyX(const std::vector<double>& U, std::vector<double>& out) const
+    {
+        ParallelFor(ny, [&](std::size_t j0, std::size_t j1) {
+            for (std::size_t j = j0; j < j1; ++j)
+            {
+                std::size_t p0 = nx * j;
+                for (std::size_t i = 0; i < nx; ++i)
+                {
+                    std::size_t p = p0 + i;
+                    double v = d1[p] * U[p];
+                    if (i > 0)
+                        v += l1[p] * U[p - 1];
+                    if (i + 1 < nx)
+                        v += u1[p] * U[p + 1];
+                    out[p] = fixed[p] ? 0.0 : v;
+                }
+            }
+        });
+    }
+
+    void ApplyY(const std::vector<double>& U, std::vector<double>& out) const
+    {
+        ParallelFor(ny, [&](std::size_t j0, std::size_t j1) {
+            for (std::size_t j = j0; j < j1; ++j)
+            {
+                std::size_t p0 = nx * j;
+                const double* lo = (j > 0) ? &U[p0 - nx] : nullptr;
+                const double* hi = (j + 1 < ny) ? &U[p0 + nx] : nullptr;
+                for (std::size_t i = 0; i < nx; ++i)
+                {
+                    std::size_t p = p0 + i;
+                    double v = d2[p] * U[p];
+                    if (lo)
+                        v += l2[p] * lo[i];
+                    if (hi)
+                        v += u2[p] * hi[i];
+                    out[p] = fixed[p] ? 0.0 : v;
+                }
+            }
+        });
+    }
+
+    void ApplyMixed(const std::vector<double>& U, std::vector<double>& out) const
+    {
+        ParallelFor(ny, [&](std::size_t j0, std::size_t j1) {
+            for (std::size_t j = j0; j < j1; ++j)
+            {
+                std::size_t p0 = nx * j;
+                if (j == 0 || j + 1 == ny)
+                {
+                    std::fill(out.begin() + p0, out.begin() + p0 + nx, 0.0);
+                    continue;
+                }
+                const double* by = &fdy[3 * j];
+                out[p0] = out[p0 + nx - 1] = 0.0;
+                for (std::size_t i = 1; i + 1 < nx; ++i)
+                {
+                    std::size_t p = p0 + i;
+                    const double* bx = &fdx[3 * i];
+                    double v = 0.0;
+                    for (int l = 0; l < 3; ++l)
+                    {
+                        const double* row = &U[p + (l - 1) * static_cast<std::ptrdiff_t>(nx)];
+                        v += by[l] * (bx[0] * row[-1] + bx[1] * row[0] + bx[2] * row[1]);
+                    }
+                    out[p] = fixed[p] ? 0.0 : mixed[p] * v;
+                }
+            }
+        });
+    }
+
+    // (I - w A1) Y = R, one contiguous x line at a time
+    void SolveX(const std::vector<double>& R, std::vector<double>& Y)
+    {
+        const Factorization& f = f1;
+        ParallelFor(ny, [&](std::size_t j0, std::size_t j1) {
+            for (std::size_t j = j0; j < j1; ++j)
+            {
+                std::size_t p0 = nx * j;
+                Y[p0] = R[p0] * f.invM[p0];
+                for (std::size_t i = 1; i < nx; ++i)
+                {
+                    std::size_t p = p0 + i;
+                    Y[p] = (R[p] - f.a[p] * Y[p - 1]) * f.invM[p];
+                }
+                for (std::size_t i = nx - 1; i-- > 0;)
+                    Y[p0 + i] -= f.cp[p0 + i] * Y[p0 + i + 1];
+            }
+        });
+    }
+
+    // (I - w A2) Y = R, the recursion runs over y for all x lines at once
+    void SolveY(const std::vector<double>& R, std::vector<double>& Y)
+    {
+        const Factorization& f = f2;
+        ParallelFor(nx, [&](std::size_t i0, std::size_t i1) {
+            for (std::size_t i = i0; i < i1; ++i)
+                Y[i] = R[i] * f.invM[i];
+            for (std::size_t j = 1; j < ny; ++j)
+            {
+                std::size_t p0 = nx * j;
+                for (std::size_t i = i0; i < i1; ++i)
+                    Y[p0 + i] = (R[p0 + i] - f.a[p0 + i] * Y[p0 + i - nx]) * f.invM[p0 + i];
+            }
+            for (std::size_t j = ny - 1; j-- > 0;)
+            {
+                std::size_t p0 = nx * j;
+                for (std::size_t i = i0; i < i1; ++i)
+                    Y[p0 + i] -= f.cp[p0 + i] * Y[p0 + i + nx];
+            }
+        });
+    }
+
+    // Scratch buffers of one step
+    std::vector<double> AU0, AU1, AU2, Y0, Y, R, A0Y, A1Y, A2Y;
+
+    static void Axpy(std::vector<double>& out, const std::vector<double>& x, double a, const std::vector<double>& y)
+    { // out = x + a y
+        for (std::size_t p = 0; p < out.size(); ++p)
+            out[p] = x[p] + a * y[p];
+    }
+
+    void Step(std::vector<double>& U, double tau, double dt, AdiScheme scheme, double theta)
+    {
+        SetBoundary(U, tau + dt);
+        const double w = theta * dt;
+        Factor(f1, w, l1, d1, u1, true);
+        Factor(f2, w, l2, d2, u2, false);
+        std::size_t N = U.size();
+
+        ApplyMixed(U, AU0);
+        ApplyX(U, AU1);
+        ApplyY(U, AU2);
+        for (std::size_t p = 0; p < N; ++p)
+            Y0[p] = U[p] + dt * (AU0[p] + AU1[p] + AU2[p]);
+
+        // Douglas sweeps: Y1 = Y0 + w A1 (Y1 - U), Y2 = Y1 + w A2 (Y2 - U)
+        Axpy(R, Y0, -w, AU1);
+        SolveX(R, Y);
+        Axpy(R, Y, -w, AU2);
+        SolveY(R, Y);
+        if (scheme == AdiScheme::Douglas)
+        {
+            U.swap(Y);
+            return;
+        }
+
+        if (scheme == AdiScheme::CraigSneyd)
+        {
+            ApplyMixed(Y, A0Y);
+            for (std::size_t p = 0; p < N; ++p)
+                Y0[p] += 0.5 * dt * (A0Y[p] - AU0[p]);
+            Axpy(R, Y0, -w, AU1);
+            SolveX(R, Y);
+            Axpy(R, Y, -w, AU2);
+            SolveY(R, Y);
+        }
+        else
+        { // Hundsdorfer-Verwer: correction with the full operator, sweeps around Y2
+            ApplyMixed(Y, A0Y);
+            ApplyX(Y, A1Y);
+            ApplyY(Y, A2Y);
+            for (std::size_t p = 0; p < N; ++p)
+                Y0[p] += 0.5 * dt * (A0Y[p] + A1Y[p] + A2Y[p] - AU0[p] - AU1[p] - AU2[p]);
+            Axpy(R, Y0, -w, A1Y);
+            SolveX(R, Y);
+            Axpy(R, Y, -w, A2Y);
+            SolveY(R, Y);
+        }
+        U.swap(Y);
+    }
+
+public:
+    AdiSolver2D(Grid1D xGrid, Grid1D yGrid, const AdiOperator2D& op, int numberThreads = 1)
+        : gx(std::move(xGrid)), gy(std::move(yGrid)), nx(gx.Size()), ny(gy.Size()), rate(op.rate),
+          threads(std::max(1, numberThreads)), dirichlet(4)
+    {
+        Build(op);
+        MarkFixed();
+    }
+
+    // Dirichlet values g(x, y, tau) on one edge (natural by default)
+    void SetDirichlet(AdiSide side, std::function<double(double, double, double)> g)
+    {
+        dirichlet[static_cast<int>(side)] = std::move(g);
+        MarkFixed();
+        f1.w = f2.w = -1.0;
+    }
+
+    // Grid values at tau = T from the terminal condition payoff(x, y); u[i + nx j]
+    std::vector<double> Solve(const std::function<double(double, double)>& payoff, double T, int NT,
+        AdiScheme scheme = AdiScheme::HundsdorferVerwer)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        std::size_t N = nx * ny;
+        std::vector<double> U(N);
+        for (std::size_t j = 0; j < ny; ++j)
+            for (std::size_t i = 0; i < nx; ++i)
+                U[i + nx * j] = payoff(gx[i], gy[j]);
+        for (auto* v : { &AU0, &AU1, &AU2, &Y0, &Y, &R, &A0Y, &A1Y, &A2Y })
+            v->assign(N, 0.0);
+        int members = std::min(threads, static_cast<int>(std::max(nx, ny)));
+        if (members > 1)
+            team = std::make_unique<LineTeam>(members);
+
+        double theta = (scheme == AdiScheme::HundsdorferVerwer) ? 0.5 + std::sqrt(3.0) / 6.0 : 0.5;
+        double dt = T / NT;
+        // Damping: the first step as two implicit Douglas half steps
+        Step(U, 0.0, 0.5 * dt, AdiScheme::Douglas, 1.0);
+        Step(U, 0.5 * dt, 0.5 * dt, AdiScheme::Douglas, 1.0);
+        for (int n = 1; n < NT; ++n)
+            Step(U, n * dt, dt, scheme, theta);
+        SetBoundary(U, T);
+        team.reset();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        return U;
+    }
+
+    // Bilinear interpolation of grid values
+    double Interpolate(const std::vector<double>& U, double x, double y) const
+    {
+        auto locate = [](const Grid1D& g, double v, std::size_t& k, double& w) {
+            const auto& n = g.Nodes();
+            v = std::min(std::max(v, n.front()), n.back());
+            k = std::min<std::size_t>(std::upper_bound(n.begin(), n.end(), v) - n.begin(), n.size() - 1) - 1;
+            w = (v - n[k]) / (n[k + 1] - n[k]);
+        };
+        std::size_t i, j;
+        double wx, wy;
+        locate(gx, x, i, wx);
+        locate(gy, y, j, wy);
+        std::size_t p = i + nx * j;
+        return (1.0 - wy) * ((1.0 - wx) * U[p] + wx * U[p + 1]) + wy * ((1.0 - wx) * U[p + nx] + wx * U[p + nx + 1]);
+    }
+
+    const Grid1D& XGrid() const { return gx; }
+    const Grid1D& YGrid() const { return gy; }
+    double ElapsedTime() const { return elapsed; }   // Seconds spent in the last Solve
+};
+
+class HestonAdiPricer
+{
+private:
+    std::shared_ptr<HestonModel> model;
+    int nS, nV, NT;
+    AdiScheme scheme;
+    int threads;
+    mutable double elapsed = 0.0;
+
+    template <typename PayoffPolicy>
+    double Run(const PayoffPolicy& payoff, double barrier, double rebate) const
+    {
+        const HestonModel& m = *model;
+        double S0 = m.Spot(), v0 = m.InitialVariance();
+        bool knockOut = barrier < std::numeric_limits<double>::infinity();
+        if (knockOut && S0 >= barrier)
+            return rebate * std::exp(-m.Rate() * m.Expiry());
+
+        double sMax = knockOut ? barrier : 8.0 * S0, vMax = 5.0;
+        Grid1D gs = Grid1D::Concentrated(0.0, sMax, nS, S0, S0 / 5.0).WithNode(S0);
+        Grid1D gv = Grid1D::Concentrated(0.0, vMax, nV, 0.0, vMax / 500.0).WithNode(v0);
+
+        double r = m.Rate(), q = m.Dividend(), k = m.Kappa(), th = m.Theta(), xi = m.Xi(), rho = m.Rho();
+        AdiOperator2D op;
+        op.axx = [](double S, double v) { return 0.5 * S * S * v; };
+        op.ayy = [xi](double, double v) { return 0.5 * xi * xi * v; };
+        op.axy = [rho, xi](double S, double v) { return rho * xi * S * v; };
+        op.bx = [r, q](double S, double) { return (r - q) * S; };
+        op.by = [k, th](double, double v) { return k * (th - v); };
+        op.rate = r;
+
+        AdiSolver2D solver(gs, gv, op, threads);
+        if (knockOut)
+            solver.SetDirichlet(AdiSide::XUpper, [rebate, r](double, double, double tau) { return rebate * std::exp(-r * tau); });
+        auto U = solver.Solve([&payoff, knockOut, barrier, rebate](double S, double) {
+            return (knockOut && S >= barrier) ? rebate : payoff(S);
+        }, m.Expiry(), NT, scheme);
+        elapsed = solver.ElapsedTime();
+        return solver.Interpolate(U, S0, v0);
+    }
+
+public:
+    HestonAdiPricer(std::shared_ptr<HestonModel> hestonModel, int spotNodes = 100, int varianceNodes = 50,
+        int numSubdivisions = 50, AdiScheme adiScheme = AdiScheme::HundsdorferVerwer, int numberThreads = 1)
+        : model(std::move(hestonModel)), nS(spotNodes), nV(varianceNodes), NT(numSubdivisions), scheme(adiScheme),
+          threads(numberThreads)
+    {
+        if (model->JumpIntensity() > 0.0)
+            throw std::invalid_argument("HestonAdiPricer: jumps need a PIDE; the ADI solver covers pure Heston only");
+    }
+
+    template <typename PayoffPolicy>
+    double Price(const PayoffPolicy& payoff) const
+    {
+        return Run(payoff, std::numeric_limits<double>::infinity(), 0.0);
+    }
+
+    // Up-and-out with the BarrierBatchConsumer conventions (alive while S < barrier, rebate paid at
+    // expiry), monitored continuously
+    template <typename PayoffPolicy>
+    double PriceUpAndOut(const PayoffPolicy& payoff, double barrier, double rebate = 0.0) const
+    {
+        return Run(payoff, barrier, rebate);
+    }
+
+    double ElapsedTime() const { return elapsed; }   // Seconds of the last grid solve
+};
+
+class TwoAssetAdiPricer
+{
+private:
+    double S1, S2, vol1, vol2, rho, r, q1, q2, T;
+    int n1, n2, NT;
+    AdiScheme scheme;
+    int threads;
+    mutable double elapsed = 0.0;
+
+public:
+    TwoAssetAdiPricer(double spot1, double spot2, double volatility1, double volatility2, double correlation,
+        double rate, double dividend1, double dividend2, double maturity, int nodes1 = 80, int nodes2 = 80,
+        int numSubdivisions = 50, AdiScheme adiScheme = AdiScheme::HundsdorferVerwer, int numberThreads = 1)
+        : S1(spot1), S2(spot2), vol1(volatility1), vol2(volatility2), rho(correlation), r(rate), q1(dividend1),
+          q2(dividend2), T(maturity), n1(nodes1), n2(nodes2), NT(numSubdivisions), scheme(adiScheme),
+          threads(numberThreads) {}
+
+    // payoff(S1, S2), e.g. SpreadPayoff
+    template <typename PayoffPolicy>
+    double Price(const PayoffPolicy& payoff) const
+    {
+        Grid1D g1 = Grid1D::Concentrated(0.0, 8.0 * S1, n1, S1, S1 / 5.0).WithNode(S1);
+        Grid1D g2 = Grid1D::Concentrated(0.0, 8.0 * S2, n2, S2, S2 / 5.0).WithNode(S2);
+
+        double a1 = 0.5 * vol1 * vol1, a2 = 0.5 * vol2 * vol2, c = rho * vol1 * vol2, b1 = r - q1, b2 = r - q2;
+        AdiOperator2D op;
+        op.axx = [a1](double x, double) { return a1 * x * x; };
+        op.ayy = [a2](double, double y) { return a2 * y * y; };
+        op.axy = [c](double x, double y) { return c * x * y; };
+        op.bx = [b1](double x, double) { return b1 * x; };
+        op.by = [b2](double, double y) { return b2 * y; };
+        op.rate = r;
+
+        AdiSolver2D solver(g1, g2, op, threads);
+        auto U = solver.Solve([&payoff](double x, double y) { return payoff(x, y); }, T, NT, scheme);
+        elapsed = solver.ElapsedTime();
+        return solver.Interpolate(U, S1, S2);
+    }
+
+    double ElapsedTime() const { return elapsed; }
+};
+
+#endif
@@ -0,0 +1,361 @@
+/*
+Analytics.hpp
+
+Closed-Form Black-Scholes Formulas and Implied Volatility Inversion
+
+Overview:
+---------
+This header collects the analytic references used alongside the Monte Carlo
+engine: Black-Scholes prices and Greeks with a continuous dividend yield, and
+an implied volatility solver that inverts simulated prices back to Black-Scholes
+volatilities (e.g. for surface generation).
+
+Functions:
+----------
+- NormalPdf / NormalCdf: standard normal density and distribution.
+- BlackScholesPrice(S, K, T, r, q, sig, type): European price, type 1 == call, -1 == put.
+- BlackScholesDelta / BlackScholesVega: first-order sensitivities.
+- DigitalPrice(S, K, T, r, q, sig, type): cash-or-nothing option paying 1.
+- ImpliedVolatility(price, S, K, T, r, q, type): Newton iteration on vega,
+  safeguarded by bisection. Returns NaN when the price violates the static
+  no-arbitrage bounds (so it cannot be inverted).
+- GeometricAsianPrice: discretely monitored geometric-average option (closed form),
+  used as control variate / reference for arithmetic Asians.
+- UpAndOutCallPrice / DiscreteUpAndOutCallPrice: continuous barrier formula and its
+  Broadie-Glasserman-Kou shifted-barrier version for discrete monitoring.
+- MargrabePrice(S1, S2, T, q1, q2, sig1, sig2, rho): exchange option max(S1 - S2, 0).
+- BinomialAmericanPrice(S, K, T, r, q, sig, type, steps): Cox-Ross-Rubinstein tree
+  with early exercise, averaged over steps and steps + 1 (odd-even oscillation).
+- RegularizedGammaP / NoncentralChiSquareCdf: incomplete gamma function and the
+  Poisson-weighted noncentral chi-square distribution.
+- CevPrice(S, K, T, r, q, sigCev, beta, type): CEV European option for beta < 1
+  with absorption at zero (Schroder), dS = (r - q) S dt + sigCev S^beta dW.
+- LewisPrice(cf, S, K, T, r, q, type): European option from the characteristic
+  function cf(u) = E[exp(i u X_T)] of S_T = S exp((r - q) T + X_T), E[exp(X_T)] = 1
+  (Lewis 2001), for Levy and stochastic-volatility models. Gauss-Legendre panels
+  along the real axis until the integrand is negligible.
+- CirRateCall(r0, K, T, kappa, theta, sigma): undiscounted E[max(r_T - K, 0)] for
+  the CIR process, from its scaled noncentral chi-square law.
+
+Dependencies:
+-------------
+- <cmath>, <limits>, <algorithm>, <complex>, <vector>, <functional>
+
+*/
+
+#ifndef Analytics_HPP
+#define Analytics_HPP
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <complex>
+#include <vector>
+#include <functional>
+
+namespace Analytics
+{
+    inline double NormalPdf(double x)
+    {
+        return 0.3989422804014327 * std::exp(-0.5 * x * x);
+    }
+
+    inline double NormalCdf(double x)
+    {
+        return 0.5 * std::erfc(-x * 0.7071067811865476);
+    }
+
+    inline double BlackScholesPrice(double S, double K, double T, double r, double q, double sig, int type)
+    {
+        double dfR = std::exp(-r * T);
+        double dfQ = std::exp(-q * T);
+        if (T <= 0.0 || sig <= 0.0)
+        { // Intrinsic value on the forward
+            double fwd = S * dfQ - K * dfR;
+            return std::max(type * fwd, 0.0);
+        }
+
+        double sqrtT = std::sqrt(T);
+        double d1 = (std::log(S / K) + (r - q + 0.5 * sig * sig) * T) / (sig * sqrtT);
+        double d2 = d1 - sig * sqrtT;
+
+        if (type == 1)
+            return S * dfQ * NormalCdf(d1) - K * dfR * NormalCdf(d2);
+        else
+            return K * dfR * NormalCdf(-d2) - S * dfQ * NormalCdf(-d1);
+    }
+
+    inline double DigitalPrice(double S, double K, double T, double r, double q, double sig, int type)
+    { // Pays 1 if type * (S_T - K) > 0
+        double dfR = std::exp(-r * T);
+        if (T <= 0.0 || sig <= 0.0)
+            return type * (S * std::exp((r - q) * T) - K) > 0.0 ? dfR : 0.0;
+        double d2 = (std::log(S / K) + (r - q - 0.5 * sig * sig) * T) / (sig * std::sqrt(T));
+        return dfR * NormalCdf(type * d2);
+    }
+
+    inline double BlackScholesDelta(double S, double K, double T, double r, double q, double sig, int type)
+    {
+        double sqrtT = std::sqrt(T);
+        double d1 = (std::log(S / K) + (r - q + 0.5 * sig * sig) * T) / (sig * sqrtT);
+        double dfQ = std::exp(-q * T);
+        return (type == 1) ? dfQ * NormalCdf(d1) : -dfQ * NormalCdf(-d1);
+    }
+
+    inline double BlackScholesVega(double S, double K, double T, double r, double q, double sig)
+    {
+        double sqrtT = std::sqrt(T);
+        double d1 = (std::log(S / K) + (r - q + 0.5 * sig * sig) * T) / (sig * sqrtT);
+        return S * std::exp(-q * T) * NormalPdf(d1) * sqrtT;
+    }
+
+    inline double ImpliedVolatility(double price, double S, double K, double T, double r, double q, int type,
+        double tol = 1.0e-10, int maxIter = 100)
+    {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        if (T <= 0.0)
+            return nan;
+
+        // No-arbitrage bounds: intrinsic on the forward <= price < upper bound
+        double dfR = std::exp(-r * T);
+        double dfQ = std::exp(-q * T);
+        double lower = std::max(type * (S * dfQ - K * dfR), 0.0);
+        double upper = (type == 1) ? S * dfQ : K * dfR;
+        if (!(price > lower) || !(price < upper))
+            return nan;
+
+        double lo = 1.0e-6, hi = 5.0;
+        while (BlackScholesPrice(S, K, T, r, q, hi, type) < price && hi < 100.0)
+            hi *= 2.0;
+
+        // Start from the Brenner-Subrahmanyam guess, kept inside the bracket
+        double sig = std::sqrt(2.0 * 3.141592653589793 / T) * price / (S * dfQ);
+        if (!(sig > lo && sig < hi))
+            sig = 0.5 * (lo + hi);
+
+        for (int i = 0; i < maxIter; ++i)
+        {
+            double diff = BlackScholesPrice(S, K, T, r, q, sig, type) - price;
+            if (std::abs(diff) < tol)
+                return sig;
+
+            if (diff > 0.0) hi = sig; else lo = sig;
+
+            double vega = BlackScholesVega(S, K, T, r, q, sig);
+            double next = (vega > 1.0e-12) ? sig - diff / vega : 0.5 * (lo + hi);
+            if (!(next > lo && next < hi))
+                next = 0.5 * (lo + hi); // Newton left the bracket, bisect
+
+            if (std::abs(next - sig) < tol * (1.0 + sig))
+                return next;
+            sig = next;
+        }
+        return sig;
+    }
+
+    inline double GeometricAsianPrice(double S, double K, double T, double r, double q, double sig, int NT, int type)
+    { // Discretely monitored geometric average over the NT + 1 grid points 0, dt, ..., T (S0 included)
+
+        double dt = T / NT;
+        double N1 = NT + 1.0;
+        double m = std::log(S) + (r - q - 0.5 * sig * sig) * dt * NT / 2.0;
+        double v = sig * sig * dt * (NT * (NT + 1.0) * (2.0 * NT + 1.0) / 6.0) / (N1 * N1);
+        double sv = std::sqrt(v);
+        double d2 = (m - std::log(K)) / sv;
+        double d1 = d2 + sv;
+        double fwd = std::exp(m + 0.5 * v);
+
+        if (type == 1)
+            return std::exp(-r * T) * (fwd * NormalCdf(d1) - K * NormalCdf(d2));
+        else
+            return std::exp(-r * T) * (K * NormalCdf(-d2) - fwd * NormalCdf(-d1));
+    }
+
+    inline double UpAndOutCallPrice(double S, double K, double H, double T, double r, double q, double sig)
+    { // Continuously monitored up-and-out call, no rebate (Reiner-Rubinstein)
+
+        if (S >= H || K >= H)
+            return 0.0;
+
+        double b = r - q;
+        double sqrtT = std::sqrt(T);
+        double sv = sig * sqrtT;
+        double mu = (b - 0.5 * sig * sig) / (sig * sig);
+        double x1 = std::log(S / K) / sv + (1.0 + mu) * sv;
+        double x2 = std::log(S / H) / sv + (1.0 + mu) * sv;
+        double y1 = std::log(H * H / (S * K)) / sv + (1.0 + mu) * sv;
+        double y2 = std::log(H / S) / sv + (1.0 + mu) * sv;
+        double dfQ = std::exp((b - r) * T);
+        double dfR = std::exp(-r * T);
+        double hs2mu1 = std::pow(H / S, 2.0 * (mu + 1.0));
+        double hs2mu = std::pow(H / S, 2.0 * mu);
+
+        double A = S * dfQ * NormalCdf(x1) - K * dfR * NormalCdf(x1 - sv);
+        double B = S * dfQ * NormalCdf(x2) - K * dfR * NormalCdf(x2 - sv);
+        double C = S * dfQ * hs2mu1 * NormalCdf(-y1) - K * dfR * hs2mu * NormalCdf(-y1 + sv);
+        double D = S * dfQ * hs2mu1 * NormalCdf(-y2) - K * dfR * hs2mu * NormalCdf(-y2 + sv);
+        return A - B + C - D;
+    }
+
+    inline double DiscreteUpAndOutCallPrice(double S, double K, double H, double T, double r, double q, double sig, int NT)
+    { // Broadie-Glasserman-Kou continuity correction for NT equally spaced monitoring dates
+
+        const double beta = 0.5825971579390106; // -zeta(1/2) / sqrt(2 pi)
+        return UpAndOutCallPrice(S, K, H * std::exp(beta * sig * std::sqrt(T / NT)), T, r, q, sig);
+    }
+
+    inline double MargrabePrice(double S1, double S2, double T, double q1, double q2, double sig1, double sig2, double rho)
+    { // Option to exchange asset 2 for asset 1, max(S1 - S2, 0) at T
+
+        double sig = std::sqrt(sig1 * sig1 + sig2 * sig2 - 2.0 * rho * sig1 * sig2);
+        double sv = sig * std::sqrt(T);
+        double d1 = (std::log(S1 / S2) + (q2 - q1) * T) / sv + 0.5 * sv;
+        return S1 * std::exp(-q1 * T) * NormalCdf(d1) - S2 * std::exp(-q2 * T) * NormalCdf(d1 - sv);
+    }
+
+    inline double BinomialAmericanPrice(double S, double K, double T, double r, double q, double sig, int type, int steps)
+    { // CRR tree with early exercise; the mean of two consecutive step counts
+        auto tree = [=](int n) {
+            double dt = T / n, u = std::exp(sig * std::sqrt(dt)), d = 1.0 / u;
+            double p = (std::exp((r - q) * dt) - d) / (u - d), df = std::exp(-r * dt);
+            std::vector<double> v(n + 1);
+            for (int j = 0; j <= n; ++j)
+                v[j] = std::max(type * (S * std::pow(u, 2.0 * j - n) - K), 0.0);
+            for (int i = n - 1; i >= 0; --i)
+                for (int j = 0; j <= i; ++j)
+                    v[j] = std::max(df * (p * v[j + 1] + (1.0 - p) * v[j]), type * (S * std::pow(u, 2.0 * j - i) - K));
+            return v[0];
+        };
+        return 0.5 * (tree(steps) + tree(steps + 1));
+    }
+
+    inline double RegularizedGammaP(double a, double x)
+    { // P(a, x) = gamma(a, x) / Gamma(a): series below a + 1, continued fraction above
+        if (x <= 0.0)
+            return 0.0;
+        double lnPrefix = a * std::log(x) - x - std::lgamma(a);
+        if (x < a + 1.0)
+        {
+            double term = 1.0 / a, sum = term;
+            for (int n = 1; n < 1000 && std::abs(term) > std::abs(sum) * 1e-16; ++n)
+            {
+                term *= x / (a + n);
+                sum += term;
+            }
+            return std::min(1.0, sum * std::exp(lnPrefix));
+        }
+        const double tiny = 1e-300;
+        double b = x + 1.0 - a, c = 1.0 / tiny, d = 1.0 / b, h = d;
+        for (int n = 1; n < 1000; ++n)
+        {
+            double an = -n * (n - a);
+            b += 2.0;
+            d = an * d + b;
+            if (std::abs(d) < tiny) d = tiny;
+            c = b + an / c;
+            if (std::abs(c) < tiny) c = tiny;
+            d = 1.0 / d;
+            double delta = d * c;
+            h *= delta;
+            if (std::abs(delta - 1.0) < 1e-16)
+                break;
+        }
+        return std::max(0.0, 1.0 - std::exp(lnPrefix) * h);
+    }
+
+    inline double NoncentralChiSquareCdf(double x, double df, double nc)
+    { // Poisson(nc / 2) mixture of central chi-square cdfs, summed outwards from the mode
+        if (x <= 0.0)
+            return 0.0;
+        double lambda = 0.5 * nc;
+        long long j0 = static_cast<long long>(std::floor(lambda));
+        double logW0 = -lambda + (j0 > 0 ? j0 * std::log(lambda) : 0.0) - std::lgamma(j0 + 1.0);
+        double sum = 0.0;
+
+        double logW = logW0;
+        for (long long j = j0; ; ++j)
+        { // Upwards; the weights decay and so does P(df / 2 + j, x / 2)
+            double term = std::exp(logW) * RegularizedGammaP(0.5 * df + j, 0.5 * x);
+            sum += term;
+            if ((term < 1e-17 && j > lambda) || j - j0 > 100000)
+                break;
+            logW += std::log(lambda) - std::log(j + 1.0);
+        }
+        logW = logW0;
+        for (long long j = j0 - 1; j >= 0; --j)
+        {
+            logW += std::log(j + 1.0) - std::log(lambda);
+            double term = std::exp(logW) * RegularizedGammaP(0.5 * df + j, 0.5 * x);
+            sum += term;
+            if (term < 1e-17)
+                break;
+        }
+        return std::min(1.0, sum);
+    }
+
+    inline double CevPrice(double S, double K, double T, double r, double q, double sigCev, double beta, int type)
+    { // Schroder (1989) for 0 <= beta < 1; zero is absorbing
+        double p = 1.0 - beta;
+        double b = r - q;
+        double v = (std::abs(b) < 1e-12) ? sigCev * sigCev * T
+            : sigCev * sigCev / (2.0 * b * (beta - 1.0)) * (std::exp(2.0 * b * (beta - 1.0) * T) - 1.0);
+        double a = std::pow(K * std::exp(-b * T), 2.0 * p) / (p * p * v);
+        double c = std::pow(S, 2.0 * p) / (p * p * v);
+        double k = 1.0 / p;
+
+        double call = S * std::exp(-q * T) * (1.0 - NoncentralChiSquareCdf(a, k + 2.0, c))
+            - K * std::exp(-r * T) * NoncentralChiSquareCdf(c, k, a);
+        if (type == 1)
+            return call;
+        // Put-call parity holds: the absorbed process is a martingale after discounting
+        return call - S * std::exp(-q * T) + K * std::exp(-r * T);
+    }
+
+    inline double CirRateCall(double r0, double K, double T, double kappa, double theta, double sigma)
+    { // r_T = c Y, Y ~ chi'^2(df, nc); E[Y; Y > k] = df Q(k; df + 2) + nc Q(k; df + 4)
+        double e = std::exp(-kappa * T);
+        double c = sigma * sigma * (1.0 - e) / (4.0 * kappa);
+        double df = 4.0 * kappa * theta / (sigma * sigma);
+        double nc = r0 * e / c;
+        double k = std::max(K, 0.0) / c;
+        double tail = df * (1.0 - NoncentralChiSquareCdf(k, df + 2.0, nc))
+            + nc * (1.0 - NoncentralChiSquareCdf(k, df + 4.0, nc));
+        return c * (tail - k * (1.0 - NoncentralChiSquareCdf(k, df, nc))) - std::min(K, 0.0);
+    }
+
+    using CharacteristicFunction = std::function<std::complex<double>(std::complex<double>)>;
+
+    inline double LewisPrice(const CharacteristicFunction& cf, double S, double K, double T, double r, double q, int type)
+    { // C = S e^(-qT) - sqrt(S K) e^(-(r + q) T / 2) / pi * int_0^inf Re[e^(iuk) cf(u - i/2)] / (u^2 + 1/4) du
+        static const double nodes[8] = { -0.9602898564975363, -0.7966664774136267, -0.5255324099163290, -0.1834346424956498,
+            0.1834346424956498, 0.5255324099163290, 0.7966664774136267, 0.9602898564975363 };
+        static const double weights[8] = { 0.1012285362903763, 0.2223810344533745, 0.3137066458778873, 0.3626837833783620,
+            0.3626837833783620, 0.3137066458778873, 0.2223810344533745, 0.1012285362903763 };
+
+        const double k = std::log(S / K) + (r - q) * T;
+        const std::complex<double> halfI(0.0, 0.5);
+        const double width = 0.5, uMax = 1e4;
+        double integral = 0.0;
+        for (double a = 0.0; a < uMax; a += width)
+        {
+            double panel = 0.0, size = 0.0;
+            for (int j = 0; j < 8; ++j)
+            {
+                double u = a + 0.5 * width * (nodes[j] + 1.0);
+                std::complex<double> phi = cf(std::complex<double>(u, 0.0) - halfI);
+                double w = 1.0 / (u * u + 0.25);
+                panel += weights[j] * (std::exp(std::complex<double>(0.0, u * k)) * phi).real() * w;
+                size = std::max(size, std::abs(phi) * w);
+            }
+            integral += 0.5 * width * panel;
+            if (a > 10.0 && size * width < 1e-14)
+                break;
+        }
+        double call = S * std::exp(-q * T) - std::sqrt(S * K) * std::exp(-0.5 * (r + q) * T) * integral / 3.14159265358979323846;
+        if (type == 1)
+            return call;
+        return call - S * std::exp(-q * T) + K * std::exp(-r * T);
+    }
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include "Benchmark.hpp"
+#include <iostream>
+#include <string>
+
+// Usage:
+//   Benchmark run [out.json] [--quick]          Time all scenarios, write JSON (default bench.json)
+//   Benchmark compare baseline.json current.json Diff against a baseline, non-zero exit on regression
+int main(int argc, char* argv[])
+{
+	std::string mode = argc > 1 ? argv[1] : "run";
+
+	if (mode == "compare")
+	{
+		if (argc < 4)
+		{
+			std::cerr << "Usage: Benchmark compare baseline.json current.json" << std::endl;
+			return 2;
+		}
+		auto baseline = BenchmarkHarness::ReadJson(argv[2]);
+		auto current = BenchmarkHarness::ReadJson(argv[3]);
+		int regressions = BenchmarkHarness::Compare(baseline, current, std::cout);
+		std::cout << regressions << " regression(s)" << std::endl;
+		return regressions == 0 ? 0 : 1;
+	}
+
+	std::string out = "bench.json";
+	bool quick = false;
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		if (arg == "--quick")
+			quick = true;
+		else
+			out = arg;
+	}
+
+	BenchmarkHarness harness(quick ? 3 : 5, quick ? 0.1 : 1.0);
+	auto results = harness.Run(std::cout);
+	BenchmarkHarness::WriteJson(out, results);
+	std::cout << "Results written to " << out << std::endl;
+
+	return 0;
+}
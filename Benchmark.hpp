@@ -0,0 +1,795 @@
+/*
+Benchmark.hpp
+
+Performance Regression Benchmarks with Baseline Comparison
+
+Overview:
+---------
+`BenchmarkHarness` times a fixed set of engine scenarios and writes the results
+as JSON, so every change can be compared against a stored baseline:
+
+| Scenario              | Model / Scheme      | NT   | Pricer               |
+|-----------------------|---------------------|------|----------------------|
+| european_gbm_nt1      | GBM / Euler         | 1    | EuropeanPricer       |
+| european_policy_nt1   | GBM / Euler         | 1    | BasicEuropeanPricer<VanillaPayoff, FlatRateDiscount> |
+| asian_gbm_nt252       | GBM / Euler         | 252  | AsianPricer          |
+| barrier_bb_nt1000     | GBM / Milstein      | 1000 | BrownianBridgePricer |
+| cev_milstein_nt252    | CEV / Milstein      | 252  | EuropeanPricer       |
+| cev_exact_nt1         | CEV / ExactCevFdm   | 1    | EuropeanPricer, one exact step per path |
+| vg_exact_nt1          | VG / VarianceGammaFdm | 1  | EuropeanPricer, gamma subordinator      |
+| nig_exact_nt1         | NIG / NigFdm        | 1    | EuropeanPricer, IG subordinator         |
+| heston_qe_nt50        | Heston / QE         | 50   | MCStochVolEngine, European consumer     |
+| bates_qe_nt50         | Bates / QE + jumps  | 50   | same; compare with heston_qe_nt50       |
+| slv_calibrate_nt250   | SLV / QE + leverage | 250  | SlvCalibrator, 100k particles, all cores |
+| regime3_nt50          | regime-switching GBM | 50  | MCRegimeSwitchingEngine, 3 regimes      |
+| adi_heston_hv_200x100 | Heston / ADI (HV)   | 100  | HestonAdiPricer, 200 x 100 grid; "paths" = grid nodes |
+| pide_merton_fft_1024  | Merton / PIDE IMEX  | 100  | JumpDiffusionPide, American put, FFT jump convolution |
+| pide_merton_direct_1024 | Merton / PIDE IMEX | 100 | same with the O(N M) convolution            |
+| proxy_price_batch     | Chebyshev proxy     | 1    | ChebyshevProxy::PriceBatch, BS 24x10x10; "paths" = points |
+| proxy_greeks_batch    | Chebyshev proxy     | 1    | ChebyshevProxy::GreeksBatch, same proxy |
+| dml_train_8192        | GBM / Exact + MLP   | 20   | DifferentialSurrogate::Train, 3 x 20 units; "paths" = samples, NT = epochs |
+| dml_price_batch       | differential MLP    | 1    | DifferentialSurrogate::PriceBatch, 3 x 20 units; "paths" = points |
+| dml_greeks_batch      | differential MLP    | 1    | DifferentialSurrogate::GreeksBatch, same network |
+| planner_book          | GBM + CEV / planned | 1    | ErrorBudgetPlanner::Price on a 4-contract book at RMSE 0.01, pilots included; "paths" = contracts |
+| planner_baseline_book | GBM + CEV / Euler   | 252  | ErrorBudgetPlanner::Run, first scheme with no VR on the same book; "paths" = all four contracts |
+| portfolio_netted_8    | GBM / Exact         | 1    | PortfolioBatchConsumer, 8 vanillas netted in one pass with Euler allocation |
+| portfolio_separate_8  | GBM / Exact         | 1    | 8 BasicEuropeanBatchConsumer<VanillaPayoff, FlatRateDiscount> on the same engine |
+| european_batch_nt1    | GBM / Exact         | 1    | BasicEuropeanBatchConsumer alone: the reference for european_sketch_nt1 |
+| european_sketch_nt1   | GBM / Exact         | 1    | Same, plus a SketchBatchConsumer on the discounted payoff (t-digest + 500-bin histogram) |
+| asian_batch_nt252     | GBM / Euler         | 252  | AsianBatchConsumer from inception: the reference for asian_seasoned_nt126 |
+| asian_seasoned_nt126  | GBM / Euler         | 126  | Same contract at mid-life: SeasonedState with 127 fixings, SeasonedSde on the remaining half |
+| surface_<stage>       | GBM / Milstein      | 252  | SurfacePipeline, 2 underlyings x 3 expiries x 21 strikes, 1 thread; the seconds of one stage: simulate, evaluate, invert, write (CSV + binary); NT = 1 except simulate |
+| scaling_t<n>          | GBM / Euler         | 252  | EuropeanPricer, n = 1, 2, 4, ..., #cores |
+| batch_stepmajor_nt50  | GBM / Euler         | 50   | MCBatchEngine, all paths per step       |
+| batch_blocked_nt50    | GBM / Euler         | 50   | MCBatchEngine, auto-tuned cache tiles   |
+| cir_exact_nt1         | CIR / ExactCirFdm   | 1    | MCBatchEngine, rate call, block sampler |
+| cir_qe_nt12           | CIR / QeCirFdm      | 12   | MCBatchEngine, rate call                |
+| cir_fulltrunc_nt12    | CIR / full trunc.   | 12   | MCBatchEngine, rate call                |
+| stiff_<scheme>_nt10   | stiff CIR           | 10   | rate call; euler, dieuler, dimil, bim, logeuler, reflect |
+| pipeline_asian_nt252  | GBM / Euler         | 252  | AsianPricer, MCMediator pipelined mode  |
+| pinned_t<n>           | GBM / Euler         | 252  | as scaling_t<#cores>, threads pinned    |
+| sockets1_t<n>         | GBM / Euler         | 252  | n = CPUs of node 0, all on one node     |
+| sockets2_t<n>         | GBM / Euler         | 252  | same n scattered over two nodes         |
+
+The socket scenarios only exist on hosts with at least two NUMA nodes.
+The stiff scenarios use ImplicitFdm.hpp: drift-implicit Euler (theta 0.5) and
+Milstein, balanced implicit, log-Euler and reflected Euler, against explicit Euler.
+
+Metrics (per scenario):
+-----------------------
+- seconds     : median wall time over the repetitions.
+- noise       : robust relative spread of the repetitions (1.4826 * MAD / median).
+- paths_per_sec, ns_per_step : throughput derived from the median.
+- peak_rss_kb : process high-water mark while the scenario ran (Linux resets it
+                through /proc/self/clear_refs; elsewhere the process-wide maximum).
+- tracked_peak_bytes : peak of the engine's tracked containers (see MemoryTracker.hpp).
+
+Baseline comparison:
+--------------------
+A scenario regresses when its ns/step grows by more than
+    max(minRelative, nSigma * sqrt(noise_base^2 + noise_current^2))
+so noisy scenarios need a larger slowdown before they are flagged.
+
+Usage:
+------
+See Benchmark.cpp: `Benchmark run current.json` and
+`Benchmark compare baseline.json current.json`.
+
+*/
+
+#ifndef Benchmark_HPP
+#define Benchmark_HPP
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <cmath>
+#include <stdexcept>
+#include <chrono>
+#include <random>
+#include <cstdio>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "Rng.hpp"
+#include "Pricers.hpp"
+#include "MCParallelEngine.hpp"
+#include "MCBatchEngine.hpp"
+#include "ExactCevFdm.hpp"
+#include "CirFdm.hpp"
+#include "ImplicitFdm.hpp"
+#include "LevyModels.hpp"
+#include "StochasticVolatility.hpp"
+#include "StochasticLocalVolatility.hpp"
+#include "RegimeSwitching.hpp"
+#include "AdiSolver.hpp"
+#include "PideSolver.hpp"
+#include "ChebyshevProxy.hpp"
+#include "DifferentialML.hpp"
+#include "ErrorBudgetPlanner.hpp"
+#include "PortfolioPricer.hpp"
+#include "DistributionSketch.hpp"
+#include "SurfacePipeline.hpp"
+#include "MemoryTracker.hpp"
+
+struct BenchResult
+{
+    std::string name;
+    int NSim = 0;
+    int NT = 0;
+    int threads = 1;
+    double seconds = 0.0;
+    double noise = 0.0;
+    double pathsPerSec = 0.0;
+    double nsPerStep = 0.0;
+    long peakRssKb = 0;
+    long long trackedPeakBytes = 0;
+};
+
+struct BenchScenario
+{
+    std::string name;
+    int NSim;
+    int NT;
+    int threads;
+    MCWorkerFactory worker;
+    std::function<double()> custom = nullptr;   // Optional: runs the scenario itself, returns seconds
+    WorkerPlacement::Policy placement = WorkerPlacement::Policy::None;
+    int maxNodes = 0;                   // With placement: restrict workers to the first nodes
+};
+
+class BenchmarkHarness
+{
+private:
+    int repetitions;
+    double scale;
+
+    class QuietScope
+    { // Pricers report on std::cout in PostProcess()
+    private:
+        std::ostringstream sink;
+        std::streambuf* old;
+    public:
+        QuietScope() : old(std::cout.rdbuf(sink.rdbuf())) {}
+        ~QuietScope() { std::cout.rdbuf(old); }
+    };
+
+    static constexpr double r = 0.08, v = 0.3, d = 0.0022, IC = 60.0, T = 0.25, K = 65.0;
+
+    static Payoff Call()
+    {
+        return [](double S) { return std::max(S - K, 0.0); };
+    }
+
+    static Discounter Df()
+    {
+        double df = std::exp(-r * T);
+        return [df]() { return df; };
+    }
+
+    static MCWorker Bind(std::shared_ptr<ISde> sde, std::shared_ptr<FdmBase> fdm, unsigned seed, std::shared_ptr<IPricer> op)
+    {
+        return MCWorker{ std::make_tuple(sde, fdm, std::shared_ptr<IRng>(std::make_shared<BoxMullerNet>(seed))),
+            [op](const std::vector<double>& path) { op->ProcessPath(path); },
+            [op]() { op->PostProcess(); } };
+    }
+
+    static MCWorkerFactory EuropeanGbm(int NT)
+    {
+        return [NT](int id) {
+            auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+            return Bind(sde, std::make_shared<EulerFdm>(sde, NT), 1000u + id, std::make_shared<EuropeanPricer>(Call(), Df()));
+        };
+    }
+
+    static double Median(std::vector<double> xs)
+    {
+        std::sort(xs.begin(), xs.end());
+        std::size_t n = xs.size();
+        return (n % 2) ? xs[n / 2] : 0.5 * (xs[n / 2 - 1] + xs[n / 2]);
+    }
+
+public:
+    explicit BenchmarkHarness(int reps = 5, double pathScale = 1.0) : repetitions(std::max(1, reps)), scale(pathScale) {}
+
+    std::vector<BenchScenario> Scenarios() const
+    {
+        auto n = [this](int paths) { return std::max(1, static_cast<int>(paths * scale)); };
+        std::vector<BenchScenario> sc;
+
+        sc.push_back({ "european_gbm_nt1", n(2000000), 1, 1, EuropeanGbm(1) });
+
+        // Same run with a compile-time payoff and a precomputed discount factor
+        sc.push_back({ "european_policy_nt1", n(2000000), 1, 1, [](int id) {
+            auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+            return Bind(sde, std::make_shared<EulerFdm>(sde, 1), 1000u + id,
+                std::make_shared<BasicEuropeanPricer<VanillaPayoff, FlatRateDiscount>>(VanillaPayoff(K, 1), FlatRateDiscount(r, T)));
+        } });
+
+        sc.push_back({ "asian_gbm_nt252", n(40000), 252, 1, [](int id) {
+            auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+            return Bind(sde, std::make_shared<EulerFdm>(sde, 252), 2000u + id, std::make_shared<AsianPricer>(Call(), Df()));
+        } });
+
+        sc.push_back({ "barrier_bb_nt1000", n(10000), 1000, 1, [](int id) {
+            auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+            auto fdm = std::make_shared<MilsteinFdm>(sde, 1000);
+            return Bind(sde, fdm, 3000u + id, std::make_shared<BrownianBridgePricer>(Call(), Df(), sde, fdm->k, 3100u + id));
+        } });
+
+        sc.push_back({ "cev_milstein_nt252", n(40000), 252, 1, [](int id) {
+            auto sde = std::make_shared<CEV>(r, v, d, IC, T, 0.5);
+            return Bind(sde, std::make_shared<MilsteinFdm>(sde, 252), 4000u + id, std::make_shared<EuropeanPricer>(Call(), Df()));
+        } });
+
+        sc.push_back({ "cev_exact_nt1", n(200000), 1, 1, [](int id) {
+            auto sde = std::make_shared<CEV>(r, v, d, IC, T, 0.5);
+            return Bind(sde, std::make_shared<ExactCevFdm>(sde, 1), 4000u + id, std::make_shared<EuropeanPricer>(Call(), Df()));
+        } });
+
+        sc.push_back({ "vg_exact_nt1", n(400000), 1, 1, [](int id) {
+            auto vg = std::make_shared<VarianceGamma>(r, d, 0.25, 0.2, -0.15, IC, T);
+            return Bind(vg, std::make_shared<VarianceGammaFdm>(vg, 1), 4500u + id, std::make_shared<EuropeanPricer>(Call(), Df()));
+        } });
+
+        sc.push_back({ "nig_exact_nt1", n(400000), 1, 1, [](int id) {
+            auto nig = std::make_shared<NormalInverseGaussian>(r, d, 0.25, 0.2, -0.15, IC, T);
+            return Bind(nig, std::make_shared<NigFdm>(nig, 1), 4600u + id, std::make_shared<EuropeanPricer>(Call(), Df()));
+        } });
+
+        // Jumps on top of the same Heston parameters: the overhead of the jump pass
+        for (bool jumps : { false, true })
+        {
+            int paths = n(100000);
+            sc.push_back({ jumps ? "bates_qe_nt50" : "heston_qe_nt50", paths, 50, 1, nullptr, [jumps, paths]() {
+                std::shared_ptr<HestonModel> model = jumps
+                    ? std::make_shared<BatesModel>(IC, 0.04, r, d, 1.5, 0.04, 0.5, -0.7, T, 0.5, -0.1, 0.15)
+                    : std::make_shared<HestonModel>(IC, 0.04, r, d, 1.5, 0.04, 0.5, -0.7, T);
+                auto call = std::make_shared<BasicEuropeanBatchConsumer<VanillaPayoff, FlatRateDiscount>>(VanillaPayoff(K, 1), FlatRateDiscount(r, T));
+                MCStochVolEngine engine(model, 50, std::make_shared<BoxMullerNet>(8000u), { call }, paths);
+                engine.start();
+                return engine.ElapsedTime();
+            } });
+        }
+
+        {
+            int paths = n(100000);
+            sc.push_back({ "regime3_nt50", paths, 50, 1, nullptr, [paths]() {
+                auto model = std::make_shared<RegimeSwitchingGbm>(std::vector<double>{ r - d, r - d, r - d },
+                    std::vector<double>{ 0.15, 0.3, 0.6 },
+                    std::vector<double>{ -0.6, 0.5, 0.1, 1.0, -1.5, 0.5, 0.5, 3.5, -4.0 }, 0, IC, T);
+                auto call = std::make_shared<BasicEuropeanBatchConsumer<VanillaPayoff, FlatRateDiscount>>(VanillaPayoff(K, 1), FlatRateDiscount(r, T));
+                MCRegimeSwitchingEngine engine(model, 50, std::make_shared<BoxMullerNet>(8000u), { call }, paths);
+                engine.start();
+                return engine.ElapsedTime();
+            } });
+        }
+
+        {
+            int nodes = 200 * 100;
+            sc.push_back({ "adi_heston_hv_200x100", nodes, 100, 1, nullptr, []() {
+                auto model = std::make_shared<HestonModel>(IC, 0.04, r, d, 1.5, 0.04, 0.5, -0.7, T);
+                HestonAdiPricer pde(model, 200, 100, 100, AdiScheme::HundsdorferVerwer);
+                pde.Price(VanillaPayoff(K, 1));
+                return pde.ElapsedTime();
+            } });
+        }
+
+        for (bool fft : { true, false })
+        {
+            sc.push_back({ fft ? "pide_merton_fft_1024" : "pide_merton_direct_1024", 1024, 100, 1, nullptr, [fft]() {
+                auto model = std::make_shared<MertonJumpDiffusion>(IC, v, r, d, T, 0.1, -0.9, 0.45);
+                JumpDiffusionPide pide(model, 1024, 100, fft ? PideJumpMethod::Fft : PideJumpMethod::Direct);
+                pide.PriceAmerican(VanillaPayoff(K, -1));
+                return pide.ElapsedTime();
+            } });
+        }
+
+        for (bool greeks : { false, true })
+        {
+            int points = n(200000);
+            sc.push_back({ greeks ? "proxy_greeks_batch" : "proxy_price_batch", points, 1, 1, nullptr, [points, greeks]() {
+                auto proxy = std::make_shared<ChebyshevProxy>(ChebyshevAxis{ 0.5 * K, 1.5 * K, 24 }, ChebyshevAxis{ 0.1, 0.5, 10 },
+                    ChebyshevAxis{ 0.05, 1.0, 10 }, ChebyshevAxis::Fixed(r));
+                proxy->Build([](const ProxyPoint& p) { return Analytics::BlackScholesPrice(p.spot, K, p.time, p.rate, d, p.vol, 1); });
+
+                std::mt19937_64 gen(8000u);
+                std::uniform_real_distribution<double> unit(0.0, 1.0);
+                std::vector<ProxyPoint> pts(points);
+                for (auto& p : pts)
+                    p = { K * (0.5 + unit(gen)), 0.1 + 0.4 * unit(gen), 0.05 + 0.95 * unit(gen), r };
+                std::vector<double> prices(greeks ? 0 : points);
+                std::vector<ProxyGreeks> out(greeks ? points : 0);
+
+                auto t0 = std::chrono::steady_clock::now();
+                if (greeks)
+                    proxy->GreeksBatch(pts.data(), out.data(), pts.size());
+                else
+                    proxy->PriceBatch(pts.data(), prices.data(), pts.size());
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            } });
+        }
+
+        {
+            int samples = std::max(1024, n(8192));
+            sc.push_back({ "dml_train_8192", samples, 20, 1, nullptr, [samples]() {
+                DifferentialSampling box{ 0.5 * K, 1.5 * K, 0.1, 0.5 };
+                box.samples = samples;
+                auto data = SimulateDifferentialSamples([](double spot, double vol) {
+                    auto sde = std::make_shared<GBM>(r, vol, d, spot, T);
+                    return std::shared_ptr<FdmBase>(std::make_shared<ExactFdm>(sde, 1, spot, vol, r - d));
+                }, VanillaPayoff(K, 1), std::exp(-r * T), box);
+                DifferentialSurrogate net;
+                DifferentialTraining cfg;
+                cfg.epochs = 20;
+                net.Train(data, cfg);
+                return data.seconds + net.TrainTime();
+            } });
+        }
+
+        for (bool greeks : { false, true })
+        {
+            int points = n(200000);
+            sc.push_back({ greeks ? "dml_greeks_batch" : "dml_price_batch", points, 1, 1, nullptr, [points, greeks]() {
+                // Inference cost does not depend on the fit, so a short training run will do
+                DifferentialSampling box{ 0.5 * K, 1.5 * K, 0.1, 0.5 };
+                box.samples = 1024;
+                auto data = SimulateDifferentialSamples([](double spot, double vol) {
+                    auto sde = std::make_shared<GBM>(r, vol, d, spot, T);
+                    return std::shared_ptr<FdmBase>(std::make_shared<ExactFdm>(sde, 1, spot, vol, r - d));
+                }, VanillaPayoff(K, 1), std::exp(-r * T), box);
+                DifferentialSurrogate net;
+                DifferentialTraining cfg;
+                cfg.epochs = 1;
+                net.Train(data, cfg);
+
+                std::mt19937_64 gen(8000u);
+                std::uniform_real_distribution<double> unit(0.0, 1.0);
+                std::vector<SurrogatePoint> pts(points);
+                for (auto& p : pts)
+                    p = { K * (0.5 + unit(gen)), 0.1 + 0.4 * unit(gen) };
+                std::vector<double> prices(greeks ? 0 : points);
+                std::vector<SurrogateGreeks> out(greeks ? points : 0);
+
+                auto t0 = std::chrono::steady_clock::now();
+                if (greeks)
+                    net.GreeksBatch(pts.data(), out.data(), pts.size());
+                else
+                    net.PriceBatch(pts.data(), prices.data(), pts.size());
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            } });
+        }
+
+        for (bool planned : { true, false })
+        {
+            // Calls, a put and a digital on GBM plus a CEV call; the baseline runs the
+            // same book with the planner's first scheme, no VR and baselineNT
+            int paths = n(200000);
+            sc.push_back({ planned ? "planner_book" : "planner_baseline_book", planned ? 4 : 4 * paths, planned ? 1 : 252, 1, nullptr, [paths, planned]() {
+                auto gbm = std::make_shared<GBM>(r, v, d, IC, T);
+                double df = std::exp(-r * T), fwd = IC * std::exp((r - d) * T);
+                std::vector<PlannerContract> book{
+                    { "call", gbm, VanillaPayoff(K, 1), df, fwd, 0.01 },
+                    { "put", gbm, VanillaPayoff(K, -1), df, fwd, 0.01 },
+                    { "digital", gbm, [](double S) { return S > K ? 1.0 : 0.0; }, df, fwd, 0.01 },
+                    { "cev_call", std::make_shared<CEV>(r, v, d, IC, T, 0.5), VanillaPayoff(K, 1), df, fwd, 0.01 }
+                };
+                ErrorBudgetPlanner planner;
+                auto t0 = std::chrono::steady_clock::now();
+                for (const auto& c : book)
+                {
+                    if (planned)
+                    {
+                        planner.Price(c);
+                        continue;
+                    }
+                    PlannerPlan plan;
+                    plan.NT = 252;
+                    plan.NSim = paths;
+                    planner.Run(c, plan);
+                }
+                return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            } });
+        }
+
+        for (bool netted : { true, false })
+        {
+            // A strip of calls and puts on one underlying: one netted consumer against one
+            // consumer per position
+            int paths = n(1000000);
+            sc.push_back({ netted ? "portfolio_netted_8" : "portfolio_separate_8", paths, 1, 1, nullptr, [paths, netted]() {
+                auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+                Tuple parts = std::make_tuple(sde, std::make_shared<ExactFdm>(sde, 1, IC, v, r - d), std::make_shared<BoxMullerNet>(8000u));
+                std::vector<std::shared_ptr<IBatchConsumer>> consumers;
+                std::vector<PortfolioPosition> book;
+                for (int j = 0; j < 8; ++j)
+                {
+                    double strike = 50.0 + 4.0 * j;
+                    int type = j % 2 == 0 ? 1 : -1;
+                    if (netted)
+                        book.push_back({ "position " + std::to_string(j), type == 1 ? PositionType::Call : PositionType::Put,
+                            strike, j < 4 ? 1.0 : -1.0 });
+                    else
+                        consumers.push_back(std::make_shared<BasicEuropeanBatchConsumer<VanillaPayoff, FlatRateDiscount>>(
+                            VanillaPayoff(strike, type), FlatRateDiscount(r, T)));
+                }
+                if (netted)
+                    consumers.push_back(std::make_shared<BasicPortfolioBatchConsumer<FlatRateDiscount>>(book, FlatRateDiscount(r, T)));
+                MCBatchEngine engine(parts, consumers, paths, BatchMode::CacheBlocked);
+                engine.start();
+                return engine.ElapsedTime();
+            } });
+        }
+
+        for (bool sketched : { false, true })
+        {
+            // The cost of sketching every payoff, against the plain batch pricer
+            int paths = n(2000000);
+            sc.push_back({ sketched ? "european_sketch_nt1" : "european_batch_nt1", paths, 1, 1, nullptr, [paths, sketched]() {
+                auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+                Tuple parts = std::make_tuple(sde, std::make_shared<ExactFdm>(sde, 1, IC, v, r - d), std::make_shared<BoxMullerNet>(8000u));
+                std::vector<std::shared_ptr<IBatchConsumer>> consumers{
+                    std::make_shared<BasicEuropeanBatchConsumer<VanillaPayoff, FlatRateDiscount>>(VanillaPayoff(K, 1), FlatRateDiscount(r, T))
+                };
+                if (sketched)
+                {
+                    auto exposure = std::make_shared<SketchBatchConsumer>(VanillaPayoff(K, 1), std::exp(-r * T));
+                    exposure->AttachHistogram(0.0, 50.0, 500);
+                    consumers.push_back(exposure);
+                }
+                MCBatchEngine engine(parts, consumers, paths, BatchMode::CacheBlocked);
+                engine.start();
+                return engine.ElapsedTime();
+            } });
+        }
+
+        for (bool seasoned : { false, true })
+        {
+            // Repricing a live Asian: the known fixings replace half of the simulated steps
+            int paths = n(40000);
+            int steps = seasoned ? 126 : 252;
+            sc.push_back({ seasoned ? "asian_seasoned_nt126" : "asian_batch_nt252", paths, steps, 1, nullptr, [paths, steps, seasoned]() {
+                std::shared_ptr<ISde> sde = std::make_shared<GBM>(r, v, d, IC, T);
+                SeasonedState past;
+                if (seasoned)
+                {
+                    for (int i = 0; i <= 126; ++i)
+                        past.Observe(IC * (1.0 + 0.0005 * i));
+                    sde = std::make_shared<SeasonedSde>(sde, T / 2, IC * 1.063);
+                }
+                Tuple parts = std::make_tuple(sde, std::make_shared<EulerFdm>(sde, steps), std::make_shared<BoxMullerNet>(9000u));
+                auto asian = std::make_shared<AsianBatchConsumer>(Call(), Df(), past);
+                MCBatchEngine engine(parts, { asian }, paths, BatchMode::CacheBlocked);
+                engine.start();
+                return engine.ElapsedTime();
+            } });
+        }
+
+        for (const char* stage : { "simulate", "evaluate", "invert", "write" })
+        {
+            // One pipeline run per repetition; the scenario's time is its stage's share
+            std::string name = stage;
+            int paths = n(10000);
+            sc.push_back({ "surface_" + name, 2 * paths, name == "simulate" ? 252 : 1, 1, nullptr, [paths, name]() {
+                SurfaceConfig cfg;
+                cfg.NSim = paths;
+                cfg.threads = 1;
+                std::vector<double> strikes;
+                for (int i = 0; i <= 20; ++i)
+                    strikes.push_back(K * (0.7 + 0.03 * i));
+                SurfacePipeline pipeline(cfg);
+                auto results = pipeline.Run({ { "A", IC, r, d, v, { 0.25, 0.5, 1.0 }, strikes },
+                    { "B", 1.5 * IC, r, 0.0, 0.5 * v, { 0.25, 0.5, 1.0 }, strikes } });
+                if (name == "write")
+                {
+                    SurfacePipeline::WriteCsv("bench_surface.csv", results);
+                    SurfacePipeline::WriteBinary("bench_surface.bin", results);
+                    std::remove("bench_surface.csv");
+                    std::remove("bench_surface.bin");
+                }
+                double seconds = 0.0;
+                for (const auto& res : results)
+                    seconds += name == "simulate" ? res.timings.simulate : name == "evaluate" ? res.timings.evaluate
+                        : name == "invert" ? res.timings.invert : res.timings.write;
+                return seconds;
+            } });
+        }
+
+        {
+            int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            int particles = n(100000);
+            sc.push_back({ "slv_calibrate_nt250", particles, 250, cores, nullptr, [particles]() {
+                auto heston = std::make_shared<HestonModel>(IC, 0.04, r, d, 1.5, 0.04, 0.5, -0.7, T);
+                std::vector<double> spots, vols;
+                for (int j = 0; j <= 60; ++j)
+                { // Skewed local vol: 20% at the money, steeper on the downside
+                    spots.push_back(IC * std::exp(-1.5 + j * 0.05));
+                    vols.push_back(0.2 * std::pow(spots.back() / IC, -0.3));
+                }
+                auto lv = std::make_shared<LocalVolSurface>(std::vector<double>{ 0.0 }, spots, vols);
+                SlvCalibrator calibrator(heston, lv, 250, particles, 8000u);
+                calibrator.Calibrate();
+                return calibrator.ElapsedTime();
+            } });
+        }
+
+        int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+        std::vector<int> counts;
+        for (int t = 1; t < cores; t *= 2)
+            counts.push_back(t);
+        counts.push_back(cores);
+        for (int t : counts)
+            sc.push_back({ "scaling_t" + std::to_string(t), n(40000) * t, 252, t, EuropeanGbm(252) });
+
+        // Thread pinning at full width, and 1 vs 2 sockets at equal thread counts
+        sc.push_back({ "pinned_t" + std::to_string(cores), n(40000) * cores, 252, cores, EuropeanGbm(252), nullptr,
+            WorkerPlacement::Policy::Compact });
+        CpuTopology topology;
+        if (topology.Nodes() >= 2)
+        {
+            int t = static_cast<int>(topology.Cpus(0).size());
+            sc.push_back({ "sockets1_t" + std::to_string(t), n(40000) * t, 252, t, EuropeanGbm(252), nullptr,
+                WorkerPlacement::Policy::Compact, 1 });
+            sc.push_back({ "sockets2_t" + std::to_string(t), n(40000) * t, 252, t, EuropeanGbm(252), nullptr,
+                WorkerPlacement::Policy::Scatter, 2 });
+        }
+
+        // Large NSim: the step-major state arrays no longer fit in L2
+        for (BatchMode mode : { BatchMode::StepMajor, BatchMode::CacheBlocked })
+        {
+            int paths = n(200000);
+            sc.push_back({ mode == BatchMode::StepMajor ? "batch_stepmajor_nt50" : "batch_blocked_nt50", paths, 50, 1, nullptr,
+                [mode, paths]() {
+                    auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+                    Tuple parts = std::make_tuple(sde, std::make_shared<EulerFdm>(sde, 50), std::make_shared<BoxMullerNet>(5000u));
+                    MCBatchEngine engine(parts, { std::make_shared<AsianBatchConsumer>(Call(), Df()) }, paths, mode);
+                    engine.start();
+                    return engine.ElapsedTime();
+                } });
+        }
+
+        // CIR schemes through their block kernels (kappa 1.5, theta 4%, sigma 40%, r0 3%)
+        {
+            using CirFactory = std::function<std::shared_ptr<FdmBase>(std::shared_ptr<CIR>)>;
+            std::vector<std::pair<std::string, CirFactory>> cir = {
+                { "cir_exact_nt1", [](std::shared_ptr<CIR> sde) { return std::make_shared<ExactCirFdm>(sde, 1); } },
+                { "cir_qe_nt12", [](std::shared_ptr<CIR> sde) { return std::make_shared<QeCirFdm>(sde, 12); } },
+                { "cir_fulltrunc_nt12", [](std::shared_ptr<CIR> sde) { return std::make_shared<FullTruncationCirFdm>(sde, 12); } }
+            };
+            for (const auto& c : cir)
+            {
+                int paths = n(400000);
+                CirFactory make = c.second;
+                int NT = make(std::make_shared<CIR>(1.5, 0.04, 0.4, 0.03, 1.0))->NT;
+                sc.push_back({ c.first, paths, NT, 1, nullptr, [make, paths]() {
+                    auto sde = std::make_shared<CIR>(1.5, 0.04, 0.4, 0.03, 1.0);
+                    Tuple parts = std::make_tuple(sde, make(sde), std::make_shared<BoxMullerNet>(6000u));
+                    auto call = std::make_shared<BasicEuropeanBatchConsumer<VanillaPayoff, FixedDiscount>>(VanillaPayoff(0.04, 1), FixedDiscount(1.0));
+                    MCBatchEngine engine(parts, { call }, paths, BatchMode::CacheBlocked);
+                    engine.start();
+                    return engine.ElapsedTime();
+                } });
+            }
+        }
+
+        // Explicit Euler against the implicit and positivity-preserving schemes on a stiff
+        // CIR (kappa dt = 2); see AccuracySuite for the prices each one reaches at this NT
+        {
+            using StiffFactory = std::function<std::shared_ptr<FdmBase>(std::shared_ptr<ISde>)>;
+            std::vector<std::pair<std::string, StiffFactory>> stiff = {
+                { "euler", [](std::shared_ptr<ISde> sde) { return std::make_shared<EulerFdm>(sde, 10); } },
+                { "dieuler", [](std::shared_ptr<ISde> sde) { return std::make_shared<DriftImplicitEulerFdm>(sde, 10, 0.5); } },
+                { "dimil", [](std::shared_ptr<ISde> sde) { return std::make_shared<DriftImplicitMilsteinFdm>(sde, 10); } },
+                { "bim", [](std::shared_ptr<ISde> sde) { return std::make_shared<BalancedImplicitFdm>(sde, 10); } },
+                { "logeuler", [](std::shared_ptr<ISde> sde) { return std::make_shared<LogEulerFdm>(sde, 10); } },
+                { "reflect", [](std::shared_ptr<ISde> sde) { return std::make_shared<ReflectedEulerFdm>(sde, 10); } }
+            };
+            for (const auto& st : stiff)
+            {
+                StiffFactory make = st.second;
+                sc.push_back({ "stiff_" + st.first + "_nt10", n(200000), 10, 1, [make](int id) {
+                    auto sde = std::make_shared<CIR>(20.0, 0.04, 0.3, 0.1, 1.0);
+                    auto op = std::make_shared<BasicEuropeanPricer<VanillaPayoff, FixedDiscount>>(VanillaPayoff(0.04, 1), FixedDiscount(1.0));
+                    return Bind(sde, make(sde), 7000u + id, op);
+                } });
+            }
+        }
+
+        // Same work as asian_gbm_nt252, with RNG / stepping / payoff as overlapping stages
+        {
+            int paths = n(40000);
+            int stepThreads = std::max(1, cores - 2);
+            sc.push_back({ "pipeline_asian_nt252", paths, 252, stepThreads + 2, nullptr, [paths, stepThreads]() {
+                auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+                auto op = std::make_shared<AsianPricer>(Call(), Df());
+                MCMediator mcp(std::make_tuple(sde, std::make_shared<EulerFdm>(sde, 252), std::make_shared<BoxMullerNet>(2000u)),
+                    [op](const std::vector<double>& path) { op->ProcessPath(path); }, [op]() { op->PostProcess(); }, paths);
+                PipelineConfig config;
+                config.stepThreads = stepThreads;
+                mcp.start(config);
+                return mcp.PipelineTime();
+            } });
+        }
+
+        return sc;
+    }
+
+    BenchResult Measure(const BenchScenario& s) const
+    {
+        BenchResult res;
+        res.name = s.name;
+        res.NSim = s.NSim;
+        res.NT = s.NT;
+        res.threads = s.threads;
+
+        MemoryTracker::ResetPeakRss();
+        MemoryTracker::ResetPeaks();
+        std::vector<double> times;
+        RunMetrics metrics;
+        {
+            QuietScope quiet;
+            for (int rep = 0; rep < repetitions; ++rep)
+            {
+                if (s.custom)
+                {
+                    times.push_back(s.custom());
+                    MemoryTracker::ReportMetrics(metrics);
+                    continue;
+                }
+                MCParallelEngine engine(s.worker, s.NSim, s.threads, WorkerPlacement(s.placement, s.threads, s.maxNodes));
+                engine.start();
+                times.push_back(engine.ElapsedTime());
+                engine.ReportMetrics(metrics);
+            }
+        }
+        res.peakRssKb = static_cast<long>(metrics.Get("mem.peak_rss_kb"));
+        res.trackedPeakBytes = static_cast<long long>(metrics.Get("mem.tracked_peak_bytes"));
+
+        res.seconds = Median(times);
+        std::vector<double> dev;
+        for (double t : times)
+            dev.push_back(std::abs(t - res.seconds));
+        res.noise = (times.size() > 1 && res.seconds > 0.0) ? 1.4826 * Median(dev) / res.seconds : 0.0;
+        res.pathsPerSec = s.NSim / res.seconds;
+        res.nsPerStep = res.seconds * 1.0e9 / (static_cast<double>(s.NSim) * s.NT);
+        return res;
+    }
+
+    std::vector<BenchResult> Run(std::ostream& os = std::cout) const
+    {
+        std::vector<BenchResult> results;
+        for (const auto& s : Scenarios())
+        {
+            results.push_back(Measure(s));
+            const auto& r = results.back();
+            os << std::left << std::setw(22) << r.name << std::right << std::setw(12) << std::setprecision(4) << r.pathsPerSec
+                << " paths/s" << std::setw(10) << r.nsPerStep << " ns/step  +-" << std::setw(6) << 100.0 * r.noise << "%"
+                << std::setw(10) << r.peakRssKb << " kB\n";
+        }
+        return results;
+    }
+
+    static void WriteJson(const std::string& fileName, const std::vector<BenchResult>& results)
+    {
+        std::ofstream out(fileName);
+        if (!out)
+            throw std::runtime_error("Benchmark: cannot open " + fileName);
+
+        out << "{\n  \"scenarios\": [\n" << std::setprecision(10);
+        for (std::size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& r = results[i];
+            out << "    { \"name\": \"" << r.name << "\", \"nsim\": " << r.NSim << ", \"nt\": " << r.NT
+                << ", \"threads\": " << r.threads << ", \"seconds\": " << r.seconds << ", \"noise\": " << r.noise
+                << ", \"paths_per_sec\": " << r.pathsPerSec << ", \"ns_per_step\": " << r.nsPerStep
+                << ", \"peak_rss_kb\": " << r.peakRssKb << ", \"tracked_peak_bytes\": " << r.trackedPeakBytes << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+
+    // Reads the flat scenario objects written by WriteJson()
+    static std::vector<BenchResult> ReadJson(const std::string& fileName)
+    {
+        std::ifstream in(fileName);
+        if (!in)
+            throw std::runtime_error("Benchmark: cannot open " + fileName);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string text = ss.str();
+
+        std::vector<BenchResult> results;
+        std::size_t pos = text.find('[');
+        while ((pos = text.find('{', pos)) != std::string::npos)
+        {
+            std::size_t end = text.find('}', pos);
+            std::string obj = text.substr(pos + 1, end - pos - 1);
+            pos = end;
+
+            std::map<std::string, std::string> kv;
+            std::size_t p = 0;
+            while ((p = obj.find('"', p)) != std::string::npos)
+            {
+                std::size_t q = obj.find('"', p + 1);
+                std::string key = obj.substr(p + 1, q - p - 1);
+                std::size_t colon = obj.find(':', q);
+                std::size_t vs = obj.find_first_not_of(" \t\n\r", colon + 1);
+                std::size_t ve;
+                std::string value;
+                if (obj[vs] == '"')
+                {
+                    ve = obj.find('"', vs + 1);
+                    value = obj.substr(vs + 1, ve - vs - 1);
+                    ++ve;
+                }
+                else
+                {
+                    ve = obj.find_first_of(",", vs);
+                    value = obj.substr(vs, (ve == std::string::npos ? obj.size() : ve) - vs);
+                }
+                kv[key] = value;
+                p = (ve == std::string::npos) ? obj.size() : ve;
+            }
+
+            BenchResult r;
+            r.name = kv["name"];
+            r.NSim = std::stoi(kv["nsim"]);
+            r.NT = std::stoi(kv["nt"]);
+            r.threads = std::stoi(kv["threads"]);
+            r.seconds = std::stod(kv["seconds"]);
+            r.noise = std::stod(kv["noise"]);
+            r.pathsPerSec = std::stod(kv["paths_per_sec"]);
+            r.nsPerStep = std::stod(kv["ns_per_step"]);
+            r.peakRssKb = std::stol(kv["peak_rss_kb"]);
+            if (kv.count("tracked_peak_bytes"))
+                r.trackedPeakBytes = std::stoll(kv["tracked_peak_bytes"]);
+            results.push_back(r);
+        }
+        return results;
+    }
+
+    // Prints the per-scenario change in ns/step and returns the number of regressions
+    static int Compare(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current,
+        std::ostream& os = std::cout, double minRelative = 0.05, double nSigma = 3.0)
+    {
+        int regressions = 0;
+        os << std::left << std::setw(22) << "Scenario" << std::right << std::setw(14) << "Base ns/step" << std::setw(14)
+            << "Curr ns/step" << std::setw(10) << "Change" << std::setw(11) << "Threshold" << "  Status\n";
+
+        for (const auto& c : current)
+        {
+            auto b = std::find_if(baseline.begin(), baseline.end(), [&c](const BenchResult& x) { return x.name == c.name; });
+            if (b == baseline.end())
+            {
+                os << std::left << std::setw(22) << c.name << "  (no baseline)\n";
+                continue;
+            }
+
+            double change = (c.nsPerStep - b->nsPerStep) / b->nsPerStep;
+            double threshold = std::max(minRelative, nSigma * std::sqrt(b->noise * b->noise + c.noise * c.noise));
+            std::string status = "ok";
+            if (change > threshold)
+            {
+                status = "REGRESSION";
+                ++regressions;
+            }
+            else if (change < -threshold)
+                status = "improved";
+
+            os << std::left << std::setw(22) << c.name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(14) << b->nsPerStep << std::setw(14) << c.nsPerStep << std::setw(9) << 100.0 * change << "%"
+                << std::setw(10) << 100.0 * threshold << "%  " << status << "\n";
+            os.unsetf(std::ios::fixed);
+        }
+        return regressions;
+    }
+};
+
+#endif
@@ -0,0 +1,450 @@
+/*
+ChebyshevProxy.hpp
+
+Chebyshev Tensor Proxy for Real-Time Repricing
+
+Overview:
+---------
+`ChebyshevProxy` replaces an expensive pricer by a tensor Chebyshev interpolant
+in (S0, sigma, tau, r), tau being the time to expiry. The offline Build() calls the
+pricer once per tensor node; any engine fits behind the `Pricer` callback
+(Analytics formulas, HestonAdiPricer, JumpDiffusionPide, or a Monte Carlo run
+with fixed seeds - the interpolant inherits its noise). Online, a price costs
+one pass over the stored coefficients, with no call to the engine.
+
+- Axes are Chebyshev-Lobatto grids x_k = cos(pi k / n) mapped to [lo, hi]; an
+  axis of degree 0 (ChebyshevAxis::Fixed) is frozen at its value and adds no
+  nodes, e.g. the rate for a fixed-curve book.
+- Node values become coefficients by a DCT-I along each axis in turn. Only the
+  coefficients are stored, as spot fibres (one per vol / time / rate index),
+  each cut after its last coefficient above truncation * max |c|; all-zero
+  fibres are dropped. Fibre indices take 12 bytes per fibre on top of the
+  doubles.
+- Evaluation contracts the vol, time and rate axes with their Chebyshev values
+  T_k (one multiply-add per kept coefficient, no dependency chain), which leaves
+  one spot series per point; Clenshaw's recursion sums it. Greeks reuse the same
+  pass: vega, theta and rho contract with dT_k/dx instead of T_k, and delta and
+  gamma are Clenshaw sums of the term-by-term derivative of the spot series, so
+  no finite differences are taken.
+- The batch API runs Block points per pass with the point as the innermost
+  loop, so the contraction and the recursion vectorize across points.
+- Points outside the box are clamped to it (a Chebyshev series is not an
+  extrapolator).
+
+Validate() reprices random points of the box with a reference pricer and
+reports the maximum and RMS interpolation error (and the worst point); the
+error and the build time are published through ReportMetrics.
+
+Usage:
+------
+```cpp
+ChebyshevProxy proxy({ 60.0, 140.0, 32 }, { 0.1, 0.5, 12 }, { 0.25, 2.0, 12 }, ChebyshevAxis::Fixed(0.03));
+auto bs = [](const ProxyPoint& p) { return Analytics::BlackScholesPrice(p.spot, 100.0, p.time, p.rate, 0.01, p.vol, 1); };
+proxy.Build(bs, 4);
+ChebyshevProxyError err = proxy.Validate(bs, 10000);
+double price = proxy.Price({ 101.5, 0.22, 0.9, 0.03 });
+proxy.GreeksBatch(points.data(), greeks.data(), points.size());
+```
+
+*/
+
+#ifndef ChebyshevProxy_HPP
+#define ChebyshevProxy_HPP
+
+#include <vector>
+#include <array>
+#include <functional>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include "Metrics.hpp"
+
+struct ChebyshevAxis
+{
+    double lo, hi;
+    int degree;     // degree + 1 nodes; 0 freezes the axis at lo
+
+    static ChebyshevAxis Fixed(double value) { return { value, value, 0 }; }
+
+    double Node(int k) const
+    {
+        if (degree == 0)
+            return lo;
+        return 0.5 * (lo + hi) + 0.5 * (hi - lo) * std::cos(3.14159265358979323846 * k / degree);
+    }
+
+    // [lo, hi] -> [-1, 1], clamped
+    double ToUnit(double x) const
+    {
+        if (degree == 0)
+            return 0.0;
+        return std::min(std::max((2.0 * x - lo - hi) / (hi - lo), -1.0), 1.0);
+    }
+};
+
+struct ProxyPoint
+{
+    double spot, vol, time, rate;   // time: years to expiry
+};
+
+struct ProxyGreeks
+{
+    double price, delta, gamma, vega, theta, rho;   // theta = -dV/dtau per year
+};
+
+struct ChebyshevProxyError
+{
+    double maxAbs = 0.0;
+    double rms = 0.0;
+    ProxyPoint worst{ 0.0, 0.0, 0.0, 0.0 };
+    int samples = 0;
+};
+
+class ChebyshevProxy : public IMetricsSource
+{
+public:
+    using Pricer = std::function<double(const ProxyPoint&)>;
+    static constexpr std::size_t Block = 8;     // Points per batch pass
+
+private:
+    enum { Spot, Vol, Time, Rate };
+
+    // A coefficient tensor as its spot fibres, each cut after its last coefficient above
+    // the truncation level; fibres with none are dropped
+    struct Fibres
+    {
+        std::vector<double> coef;
+        std::vector<std::uint32_t> start;
+        std::vector<std::uint16_t> length, vol, time, rate;
+    };
+
+    std::array<ChebyshevAxis, 4> axes;
+    std::array<std::size_t, 4> n;               // Nodes per axis
+    std::array<std::size_t, 4> stride;          // Spot fastest
+    std::size_t size;
+    Fibres coef;
+    bool built = false;
+    double buildSeconds = 0.0;
+    ChebyshevProxyError lastError;
+
+    ProxyPoint NodePoint(std::size_t index) const
+    {
+        double v[4];
+        for (int a = 0; a < 4; ++a)
+            v[a] = axes[a].Node(static_cast<int>((index / stride[a]) % n[a]));
+        return { v[Spot], v[Vol], v[Time], v[Rate] };
+    }
+
+    // fn(fibre start) for every fibre along axis a
+    template <class F>
+    void ForEachFibre(int a, F fn) const
+    {
+        std::size_t outer = size / (n[a] * stride[a]);
+        for (std::size_t o = 0; o < outer; ++o)
+            for (std::size_t i = 0; i < stride[a]; ++i)
+                fn(o * n[a] * stride[a] + i);
+    }
+
+    // Node values -> Chebyshev coefficients along axis a (DCT-I of the Lobatto nodes)
+    void Transform(std::vector<double>& t, int a) const
+    {
+        int N = axes[a].degree;
+        if (N == 0)
+            return;
+        std::vector<double> cosTable((N + 1) * (N + 1)), f(N + 1);
+        for (int j = 0; j <= N; ++j)
+            for (int k = 0; k <= N; ++k)
+                cosTable[j * (N + 1) + k] = std::cos(3.14159265358979323846 * j * k / N);
+        std::size_t s = stride[a];
+        ForEachFibre(a, [&](std::size_t start) {
+            for (int k = 0; k <= N; ++k)
+                f[k] = t[start + k * s];
+            for (int j = 0; j <= N; ++j)
+            {
+                double sum = 0.5 * (f[0] + f[N] * cosTable[j * (N + 1) + N]);
+                for (int k = 1; k < N; ++k)
+                    sum += f[k] * cosTable[j * (N + 1) + k];
+                double c = 2.0 / N * sum;
+                t[start + j * s] = (j == 0 || j == N) ? 0.5 * c : c;
+            }
+        });
+    }
+
+    Fibres Compress(const std::vector<double>& c, double truncation) const
+    {
+        double cMax = 0.0;
+        for (double x : c)
+            cMax = std::max(cMax, std::abs(x));
+        double tol = truncation * cMax;
+
+        Fibres f;
+        for (std::size_t start = 0; start < size; start += n[Spot])
+        {
+            std::size_t len = n[Spot];
+            while (len > 0 && std::abs(c[start + len - 1]) <= tol)
+                --len;
+            if (len == 0)
+                continue;
+            f.start.push_back(static_cast<std::uint32_t>(f.coef.size()));
+            f.length.push_back(static_cast<std::uint16_t>(len));
+            f.vol.push_back(static_cast<std::uint16_t>((start / stride[Vol]) % n[Vol]));
+            f.time.push_back(static_cast<std::uint16_t>((start / stride[Time]) % n[Time]));
+            f.rate.push_back(static_cast<std::uint16_t>((start / stride[Rate]) % n[Rate]));
+            f.coef.insert(f.coef.end(), c.begin() + start, c.begin() + start + len);
+        }
+        return f;
+    }
+
+    // T_k(x) and dT_k/dX (in the axis' units) for k <= degree, per lane
+    template <std::size_t Lanes>
+    void Polynomials(int a, const double* x, std::vector<double>& T, std::vector<double>& dT) const
+    {
+        std::size_t m = n[a];
+        double scale = axes[a].degree > 0 ? 2.0 / (axes[a].hi - axes[a].lo) : 0.0;
+        T.resize(m * Lanes);
+        dT.resize(m * Lanes);
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+        {
+            T[lane] = 1.0;
+            dT[lane] = 0.0;
+            if (m > 1)
+            {
+                T[Lanes + lane] = x[lane];
+                dT[Lanes + lane] = 1.0;
+            }
+        }
+        for (std::size_t k = 2; k < m; ++k)
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+            {
+                double t1 = T[(k - 1) * Lanes + lane], t2 = T[(k - 2) * Lanes + lane];
+                T[k * Lanes + lane] = 2.0 * x[lane] * t1 - t2;
+                dT[k * Lanes + lane] = 2.0 * t1 + 2.0 * x[lane] * dT[(k - 1) * Lanes + lane] - dT[(k - 2) * Lanes + lane];
+            }
+        for (auto& d : dT)
+            d *= scale;
+    }
+
+    // Clenshaw on the series sum_j a_j T_j(x), Lanes interleaved: a[j * Lanes + lane]
+    template <std::size_t Lanes>
+    static void Clenshaw(const double* a, std::size_t length, const double* x, double* out)
+    {
+        double b1[Lanes] = {}, b2[Lanes] = {};
+        for (std::size_t j = length; j-- > 1;)
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+            {
+                double b0 = a[j * Lanes + lane] + 2.0 * x[lane] * b1[lane] - b2[lane];
+                b2[lane] = b1[lane];
+                b1[lane] = b0;
+            }
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+            out[lane] = a[lane] + x[lane] * b1[lane] - b2[lane];
+    }
+
+    // Coefficients of the x derivative of a series (interleaved), d_j = d_(j+2) + 2 (j + 1) a_(j+1)
+    template <std::size_t Lanes>
+    static void Differentiate(const double* a, std::size_t length, double scale, double* d)
+    {
+        std::fill(d, d + length * Lanes, 0.0);
+        for (std::size_t j = length - 1; j-- > 0;)
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+                d[j * Lanes + lane] = (j + 2 < length ? d[(j + 2) * Lanes + lane] : 0.0) + 2.0 * (j + 1) * a[(j + 1) * Lanes + lane];
+        for (std::size_t lane = 0; lane < Lanes; ++lane)
+        {
+            d[lane] *= 0.5;
+            for (std::size_t j = 0; j < length; ++j)
+                d[j * Lanes + lane] *= scale;
+        }
+    }
+
+    template <std::size_t Lanes>
+    void Run(const ProxyPoint* points, std::size_t count, double* prices, ProxyGreeks* greeks) const
+    {
+        if (!built)
+            throw std::logic_error("ChebyshevProxy: Build() must run before evaluation");
+        const std::size_t nS = n[Spot];
+        const int series = greeks ? 4 : 1;
+        thread_local std::vector<double> T[3], dT[3], acc, deriv;
+        double u[4][Block];
+        for (std::size_t begin = 0; begin < count; begin += Lanes)
+        {
+            std::size_t m = std::min(Lanes, count - begin);
+            for (std::size_t lane = 0; lane < Lanes; ++lane)
+            { // Lanes past m repeat the last point
+                const ProxyPoint& p = points[begin + std::min(lane, m - 1)];
+                u[Spot][lane] = axes[Spot].ToUnit(p.spot);
+                u[Vol][lane] = axes[Vol].ToUnit(p.vol);
+                u[Time][lane] = axes[Time].ToUnit(p.time);
+                u[Rate][lane] = axes[Rate].ToUnit(p.rate);
+            }
+            for (int a = Vol; a <= Rate; ++a)
+                Polynomials<Lanes>(a, u[a], T[a - Vol], dT[a - Vol]);
+
+            // Contract vol, time and rate: one spot series per lane (and per Greek of those axes)
+            acc.assign(series * nS * Lanes, 0.0);
+            double* const a0 = acc.data();
+            const double *T0 = T[0].data(), *T1 = T[1].data(), *T2 = T[2].data();
+            const double *D0 = dT[0].data(), *D1 = dT[1].data(), *D2 = dT[2].data();
+            for (std::size_t k = 0; k < coef.start.size(); ++k)
+            {
+                const double* c = coef.coef.data() + coef.start[k];
+                const std::size_t len = coef.length[k];
+                const std::size_t iv = coef.vol[k] * Lanes, it = coef.time[k] * Lanes, ir = coef.rate[k] * Lanes;
+                double w[4][Lanes];
+                for (std::size_t lane = 0; lane < Lanes; ++lane)
+                    w[0][lane] = T0[iv + lane] * T1[it + lane] * T2[ir + lane];
+                if (greeks)
+                    for (std::size_t lane = 0; lane < Lanes; ++lane)
+                    {
+                        w[1][lane] = D0[iv + lane] * T1[it + lane] * T2[ir + lane];
+                        w[2][lane] = T0[iv + lane] * D1[it + lane] * T2[ir + lane];
+                        w[3][lane] = T0[iv + lane] * T1[it + lane] * D2[ir + lane];
+                    }
+                for (int g = 0; g < series; ++g)
+                {
+                    double* a = a0 + g * nS * Lanes;
+                    for (std::size_t j = 0; j < len; ++j)
+                    {
+                        const double cj = c[j];     // Local copy: the stores below cannot alias it
+                        for (std::size_t lane = 0; lane < Lanes; ++lane)
+                            a[j * Lanes + lane] += w[g][lane] * cj;
+                    }
+                }
+            }
+
+            double v[6][Lanes];
+            Clenshaw<Lanes>(acc.data(), nS, u[Spot], v[0]);
+            if (!greeks)
+            {
+                std::copy(v[0], v[0] + m, prices + begin);
+                continue;
+            }
+            for (int g = 1; g < 4; ++g)
+                Clenshaw<Lanes>(acc.data() + g * nS * Lanes, nS, u[Spot], v[g + 2]);
+            double scale = axes[Spot].degree > 0 ? 2.0 / (axes[Spot].hi - axes[Spot].lo) : 0.0;
+            deriv.resize(2 * nS * Lanes);
+            Differentiate<Lanes>(acc.data(), nS, scale, deriv.data());
+            Clenshaw<Lanes>(deriv.data(), nS, u[Spot], v[1]);
+            Differentiate<Lanes>(deriv.data(), nS, scale, deriv.data() + nS * Lanes);
+            Clenshaw<Lanes>(deriv.data() + nS * Lanes, nS, u[Spot], v[2]);
+            for (std::size_t lane = 0; lane < m; ++lane)
+                greeks[begin + lane] = { v[0][lane], v[1][lane], v[2][lane], v[3][lane], -v[4][lane], v[5][lane] };
+        }
+    }
+
+public:
+    ChebyshevProxy(ChebyshevAxis spotAxis, ChebyshevAxis volAxis, ChebyshevAxis timeAxis, ChebyshevAxis rateAxis)
+        : axes{ spotAxis, volAxis, timeAxis, rateAxis }
+    {
+        for (int a = 0; a < 4; ++a)
+        {
+            if (axes[a].degree < 0 || axes[a].degree > 65534 || (axes[a].degree > 0 && !(axes[a].hi > axes[a].lo)))
+                throw std::invalid_argument("ChebyshevProxy: each axis needs 0 <= degree < 65535 and hi > lo");
+            n[a] = axes[a].degree + 1;
+        }
+        stride[Spot] = 1;
+        for (int a = Vol; a <= Rate; ++a)
+            stride[a] = stride[a - 1] * n[a - 1];
+        size = stride[Rate] * n[Rate];
+    }
+
+    // Prices every tensor node (the pricer is called concurrently when threads > 1) and keeps
+    // the coefficients above truncation * the largest one
+    void Build(const Pricer& pricer, int threads = 1, double truncation = 1e-10)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        std::vector<double> c(size);
+        int nt = std::max(1, std::min(threads, static_cast<int>(size)));
+        auto work = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i)
+                c[i] = pricer(NodePoint(i));
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < nt; ++t)
+            pool.emplace_back(work, size * t / nt, size * (t + 1) / nt);
+        work(0, size / nt);
+        for (auto& th : pool)
+            th.join();
+
+        for (int a = 0; a < 4; ++a)
+            Transform(c, a);
+        coef = Compress(c, truncation);
+        built = true;
+        buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    double Price(const ProxyPoint& p) const
+    {
+        double out;
+        Run<1>(&p, 1, &out, nullptr);
+        return out;
+    }
+
+    ProxyGreeks Greeks(const ProxyPoint& p) const
+    {
+        ProxyGreeks g;
+        Run<1>(&p, 1, nullptr, &g);
+        return g;
+    }
+
+    void PriceBatch(const ProxyPoint* points, double* out, std::size_t count) const
+    {
+        Run<Block>(points, count, out, nullptr);
+    }
+
+    void GreeksBatch(const ProxyPoint* points, ProxyGreeks* out, std::size_t count) const
+    {
+        Run<Block>(points, count, nullptr, out);
+    }
+
+    // Interpolation error against a reference pricer at uniform random points of the box
+    ChebyshevProxyError Validate(const Pricer& reference, int samples, unsigned seed = 42)
+    {
+        std::mt19937_64 gen(seed);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        auto draw = [&](const ChebyshevAxis& a) { return a.lo + (a.hi - a.lo) * unit(gen); };
+
+        ChebyshevProxyError err;
+        double sum2 = 0.0;
+        for (int i = 0; i < samples; ++i)
+        {
+            ProxyPoint p{ draw(axes[Spot]), draw(axes[Vol]), draw(axes[Time]), draw(axes[Rate]) };
+            double e = std::abs(Price(p) - reference(p));
+            sum2 += e * e;
+            if (e > err.maxAbs)
+            {
+                err.maxAbs = e;
+                err.worst = p;
+            }
+        }
+        err.samples = samples;
+        err.rms = samples > 0 ? std::sqrt(sum2 / samples) : 0.0;
+        lastError = err;
+        return err;
+    }
+
+    std::size_t Nodes() const { return size; }
+    std::size_t Coefficients() const { return coef.coef.size(); }     // Kept after truncation
+    std::size_t Bytes() const
+    {
+        return coef.coef.size() * sizeof(double) + coef.start.size() * (sizeof(std::uint32_t) + 4 * sizeof(std::uint16_t));
+    }
+    double BuildTime() const { return buildSeconds; }
+
+    void ReportMetrics(RunMetrics& m) const override
+    {
+        m.Set("proxy.build_seconds", buildSeconds);
+        m.Set("proxy.nodes", static_cast<double>(size));
+        m.Set("proxy.coefficients", static_cast<double>(Coefficients()));
+        m.Set("proxy.bytes", static_cast<double>(Bytes()));
+        m.Set("proxy.max_abs_error", lastError.maxAbs);
+        m.Set("proxy.rms_error", lastError.rms);
+        m.Set("proxy.validation_samples", lastError.samples);
+    }
+};
+
+#endif
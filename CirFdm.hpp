@@ -0,0 +1,255 @@
+/*
+CirFdm.hpp
+
+Exact, QE and Full-Truncation Euler Schemes for the CIR Square-Root Process
+
+Overview:
+---------
+The explicit schemes of Fdm.hpp step the CIR process
+
+    dr = kappa (theta - r) dt + sigma sqrt(r) dW
+
+below zero as soon as dt is not tiny compared with r / sigma^2. The three schemes
+below are built for it; each takes the `CIR` model of SDE.hpp and overrides
+`advanceBlock()` so the batch engine steps whole tiles of paths at a time.
+
+- ExactCirFdm              : r(t + dt) = c Y with Y ~ chi'^2(df, r(t) e^(-kappa dt) / c),
+                             c = sigma^2 (1 - e^(-kappa dt)) / (4 kappa),
+                             df = 4 kappa theta / sigma^2. Exact for any dt, never
+                             negative. Gamma/Poisson sampling (NoncentralChiSquare.hpp).
+- QeCirFdm                 : Andersen's quadratic-exponential scheme. Matches the first
+                             two conditional moments with a(b + Z)^2 when the
+                             conditional variance is small (psi <= psiC, default 1.5) and
+                             with a point mass at zero plus an exponential tail
+                             otherwise. Uses only the step's normal: no rejection,
+                             fully branch-free in the block loop. The step itself is
+                             `QeCirStep`, which the Heston engine reuses for its variance.
+- FullTruncationCirFdm     : Euler with r+ = max(r, 0) in drift and diffusion
+                             (Lord, Koekkoek and van Dijk). The stored state may be
+                             slightly negative; the rate is max(r, 0).
+
+Random numbers:
+---------------
+QE and full-truncation Euler consume the step's normal directly. The exact scheme
+seeds a SplitMix64 from the bits of that normal (see ExactCevFdm.hpp), so all three
+keep no state, are reentrant and cloneable.
+
+Usage:
+------
+```cpp
+auto sde = std::make_shared<CIR>(kappa, theta, sigma, r0, T);
+auto exact = std::make_shared<ExactCirFdm>(sde, 1);   // terminal laws: one step
+auto qe = std::make_shared<QeCirFdm>(sde, 12);        // path functionals
+```
+
+*/
+
+#ifndef CirFdm_HPP
+#define CirFdm_HPP
+
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "NoncentralChiSquare.hpp"
+
+class ExactCirFdm : public FdmBase
+{
+private:
+    double kappa;
+    double df;          // 4 kappa theta / sigma^2
+    double sig2;
+
+    // c(dt) and the factor e^(-kappa dt) / c(dt) mapping r(t) to the noncentrality
+    void Scale(double dt, double& c, double& decay) const
+    {
+        double e = std::exp(-kappa * dt);
+        c = sig2 * (1.0 - e) / (4.0 * kappa);
+        decay = e / c;
+    }
+
+public:
+    ExactCirFdm(std::shared_ptr<CIR> stochasticEquation, int numSubdivisions)
+        : FdmBase(stochasticEquation, numSubdivisions), kappa(stochasticEquation->Kappa()),
+          sig2(stochasticEquation->Sigma() * stochasticEquation->Sigma())
+    {
+        df = 4.0 * kappa * stochasticEquation->Theta() / sig2;
+    }
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<ExactCirFdm>(stochasticEquation);
+    }
+
+    double advance(double xn, double, double dt, double normalVar) override
+    {
+        double c, decay;
+        Scale(dt, c, decay);
+        Sampling::SplitMix64 g = Sampling::FromNormal(normalVar);
+        return c * Sampling::NoncentralChiSquare(df, std::max(xn, 0.0) * decay, g);
+    }
+
+    void advanceBlock(double* xs, const double* normalVars, std::size_t n, double, double dt) override
+    {
+        double c, decay;
+        Scale(dt, c, decay);
+
+        const std::size_t chunk = 256;
+        Sampling::SplitMix64 g[chunk];
+        double nc[chunk];
+        for (std::size_t start = 0; start < n; start += chunk)
+        {
+            std::size_t m = std::min(chunk, n - start);
+            double* x = xs + start;
+            const double* z = normalVars + start;
+
+            for (std::size_t i = 0; i < m; ++i)
+                g[i] = Sampling::FromNormal(z[i]);
+            for (std::size_t i = 0; i < m; ++i)
+                nc[i] = std::max(x[i], 0.0) * decay;
+            Sampling::NoncentralChiSquareBlock(df, nc, g, x, m);
+            for (std::size_t i = 0; i < m; ++i)
+                x[i] *= c;
+        }
+    }
+};
+
+struct QeCirStep
+{ // One Andersen QE step of the CIR process over a fixed dt; shared with the Heston engine
+    double e, k1, k2;   // Conditional mean theta + (r - theta) e, variance r k1 + k2
+    double theta;
+    double psiC;        // Switching level between the quadratic and exponential branches
+
+    QeCirStep(double kappa, double longRunMean, double sigma, double dt, double psiCritical = 1.5)
+        : theta(longRunMean), psiC(psiCritical)
+    {
+        double sig2 = sigma * sigma;
+        e = std::exp(-kappa * dt);
+        k1 = sig2 * e * (1.0 - e) / kappa;
+        k2 = theta * sig2 * (1.0 - e) * (1.0 - e) / (2.0 * kappa);
+    }
+
+    double Sample(double v, double z) const
+    {
+        double r = std::max(v, 0.0);
+        double m = theta + (r - theta) * e;
+        double psi = std::max((r * k1 + k2) / (m * m), 1e-300);
+        if (psi <= psiC)
+        {
+            double inv = 2.0 / psi;
+            double b2 = inv - 1.0 + std::sqrt(inv) * std::sqrt(inv - 1.0);
+            double b = std::sqrt(b2);
+            double a = m / (1.0 + b2);
+            return a * (b + z) * (b + z);
+        }
+        double p = (psi - 1.0) / (psi + 1.0);
+        double beta = (1.0 - p) / m;
+        double tail = 0.5 * std::erfc(z / std::sqrt(2.0));   // 1 - U with U = N(z)
+        return (tail >= 1.0 - p) ? 0.0 : std::log((1.0 - p) / tail) / beta;
+    }
+
+    // out[i] = step from v[i] with normal z[i]; out may alias v
+    void Block(const double* v, const double* z, double* out, std::size_t n) const
+    {
+        const double invSqrt2 = 1.0 / std::sqrt(2.0);
+
+        const std::size_t chunk = 256;
+        double mean[chunk], psi[chunk], quad[chunk], expo[chunk];
+        for (std::size_t start = 0; start < n; start += chunk)
+        {
+            std::size_t m = std::min(chunk, n - start);
+            const double* x = v + start;
+            const double* zz = z + start;
+            double* o = out + start;
+
+            for (std::size_t i = 0; i < m; ++i)
+            {
+                double r = std::max(x[i], 0.0);
+                mean[i] = theta + (r - theta) * e;
+                psi[i] = std::max((r * k1 + k2) / (mean[i] * mean[i]), 1e-300);
+            }
+            for (std::size_t i = 0; i < m; ++i)
+            { // Quadratic branch, evaluated for every path (psi clamped so it stays finite)
+                double inv = 2.0 / std::min(psi[i], psiC);
+                double b2 = inv - 1.0 + std::sqrt(inv) * std::sqrt(inv - 1.0);
+                double b = std::sqrt(b2);
+                quad[i] = mean[i] / (1.0 + b2) * (b + zz[i]) * (b + zz[i]);
+            }
+            for (std::size_t i = 0; i < m; ++i)
+                expo[i] = (psi[i] > psiC) ? 0.5 * std::erfc(zz[i] * invSqrt2) : 1.0;  // erfc only where it is used
+            for (std::size_t i = 0; i < m; ++i)
+            { // Exponential branch and selection
+                double p = std::max(psi[i] - 1.0, 0.0) / (psi[i] + 1.0);
+                double draw = (expo[i] >= 1.0 - p) ? 0.0 : std::log((1.0 - p) / expo[i]) * mean[i] / (1.0 - p);
+                o[i] = (psi[i] <= psiC) ? quad[i] : draw;
+            }
+        }
+    }
+};
+
+class QeCirFdm : public FdmBase
+{
+private:
+    double kappa;
+    double theta;
+    double sigma;
+    double psiC;
+
+public:
+    QeCirFdm(std::shared_ptr<CIR> stochasticEquation, int numSubdivisions, double psiCritical = 1.5)
+        : FdmBase(stochasticEquation, numSubdivisions), kappa(stochasticEquation->Kappa()),
+          theta(stochasticEquation->Theta()), sigma(stochasticEquation->Sigma()), psiC(psiCritical) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<QeCirFdm>(stochasticEquation);
+    }
+
+    double advance(double xn, double, double dt, double normalVar) override
+    {
+        return QeCirStep(kappa, theta, sigma, dt, psiC).Sample(xn, normalVar);
+    }
+
+    void advanceBlock(double* xs, const double* normalVars, std::size_t n, double, double dt) override
+    {
+        QeCirStep(kappa, theta, sigma, dt, psiC).Block(xs, normalVars, xs, n);
+    }
+};
+
+class FullTruncationCirFdm : public FdmBase
+{
+private:
+    double kappa;
+    double theta;
+    double sigma;
+
+public:
+    FullTruncationCirFdm(std::shared_ptr<CIR> stochasticEquation, int numSubdivisions)
+        : FdmBase(stochasticEquation, numSubdivisions), kappa(stochasticEquation->Kappa()),
+          theta(stochasticEquation->Theta()), sigma(stochasticEquation->Sigma()) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<FullTruncationCirFdm>(stochasticEquation);
+    }
+
+    double advance(double xn, double, double dt, double normalVar) override
+    {
+        double r = std::max(xn, 0.0);
+        return xn + kappa * (theta - r) * dt + sigma * std::sqrt(r * dt) * normalVar;
+    }
+
+    void advanceBlock(double* xs, const double* normalVars, std::size_t n, double, double dt) override
+    {
+        const double kdt = kappa * dt, kTheta = kappa * theta * dt;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            double r = std::max(xs[i], 0.0);
+            xs[i] += kTheta - kdt * r + sigma * std::sqrt(r * dt) * normalVars[i];
+        }
+    }
+};
+
+#endif
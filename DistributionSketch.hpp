@@ -0,0 +1,749 @@
+/*
+DistributionSketch.hpp
+
+Mergeable Streaming Sketches of Simulated Payoffs and Terminal Values
+
+Overview:
+---------
+Quantiles of the payoff distribution (PFE, stress levels, sanity checks) need the
+whole sample if they are computed by sorting, which at 100M paths is 800 MB per
+quantity. The sketches below read the values once, keep a summary of bounded
+size whatever NSim is, and merge, so every thread (or process) can sketch its own
+paths and the summaries are combined at the end.
+
+- TDigest: the merging t-digest of Dunning and Ertl. Values are buffered,
+  radix-sorted and merged into weighted centroids. The log-odds scale function
+  k(q) = delta / Z log(q / (1 - q)) caps the weight of a centroid at
+  q(k + 1) - q(k), so centroids are small in the tails (the outermost are
+  singletons) and large around the median; that is what PFE-type quantiles at
+  97.5% to 99.9% need. About delta / 2 centroids plus a buffer of 5 delta values
+  are kept. Quantile() and Cdf() interpolate linearly between centroid centres,
+  with the exact minimum and maximum at the ends. With delta = 200 the rank error
+  is below 1e-3 in the body and about 1e-5 in the tails.
+- FixedHistogram: counts on a fixed grid [lo, hi) with underflow and overflow.
+  Merging adds counts, so it is exact, and two histograms on the same grid from
+  different processes combine bit for bit. Quantiles are exact to a bin width
+  inside the grid.
+- DistributionSketch: a t-digest plus an optional histogram, fed together.
+
+Both merge (Merge(other)) and serialize (Save / Load, native byte order, with a
+magic and a version) so partial sketches can be written by separate processes and
+combined later.
+
+Attaching to pricers:
+---------------------
+- SketchBatchConsumer is an IBatchConsumer for MCBatchEngine. It sketches the
+  terminal values, or payoff(S_T) * scale when given a payoff (e.g. the discount
+  factor as the scale), 64 values at a time.
+- SketchingPricer wraps any IPricer for MCMediator / MCParallelEngine. It
+  forwards every path and sketches the terminal value or payoff on the way.
+  CloneEmpty() and Merge() clone and merge the sketch with the inner pricer, so
+  the cloning mode of MCParallelEngine merges the per-thread sketches with no
+  extra code.
+
+Usage:
+------
+```cpp
+auto exposure = std::make_shared<SketchBatchConsumer>(VanillaPayoff(K, 1), std::exp(-r * T));
+exposure->AttachHistogram(0.0, 50.0, 500);
+MCBatchEngine engine(parts, { call, exposure }, NSim, BatchMode::CacheBlocked);
+engine.start();
+double pfe = exposure->Sketch().Quantile(0.975);
+
+auto pricer = std::make_shared<SketchingPricer>(std::make_shared<EuropeanPricer>(payoff, discounter));
+MCParallelEngine cloned(sde, fdm, rngs, pricer, NSim, 4);
+cloned.start();
+double median = pricer->Sketch().Quantile(0.5);
+```
+
+*/
+
+#ifndef DistributionSketch_HPP
+#define DistributionSketch_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#include "Pricers.hpp"
+#include "MCBatchEngine.hpp"
+#include "Metrics.hpp"
+#include "MemoryTracker.hpp"
+
+namespace SketchIo
+{
+    template <typename T>
+    void Put(std::ostream& os, T value) { os.write(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    template <typename T>
+    T Get(std::istream& is)
+    {
+        T value;
+        if (!is.read(reinterpret_cast<char*>(&value), sizeof(T)))
+            throw std::runtime_error("DistributionSketch: truncated sketch");
+        return value;
+    }
+}
+
+class TDigest
+{
+private:
+    static constexpr std::uint32_t Magic = 0x47494454;     // "TDIG"
+    static constexpr std::uint32_t Version = 1;
+
+    struct Centroid
+    {
+        double mean;
+        double weight;
+    };
+
+    double delta;
+    std::size_t capacity;   // Buffered values before a compression
+
+    // Sorted by mean after Flush(); the buffer holds unit-weight values not merged yet.
+    // Both are mutable so that the const queries can flush.
+    mutable TrackedVector<Centroid, MemComponent::PricerState> centroids;
+    mutable TrackedVector<double, MemComponent::PricerState> buffer;
+    mutable TrackedVector<Centroid, MemComponent::PricerState> scratch;
+    mutable TrackedVector<std::uint64_t, MemComponent::PricerState> keys, keysTmp;
+
+    double total = 0.0;
+    double lo = std::numeric_limits<double>::infinity();
+    double hi = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+
+    // k2 scale of Dunning (2021): log-odds, normalised by Z = 4 log(n / delta) + 24
+    double K(double q, double Z) const
+    {
+        q = std::min(std::max(q, 1e-300), 1.0 - 1e-16);
+        return delta / Z * std::log(q / (1.0 - q));
+    }
+
+    double Q(double k, double Z) const { return 1.0 / (1.0 + std::exp(-k * Z / delta)); }
+
+    // One sweep over `scratch` (sorted): merge neighbours while the merged centroid
+    // stays inside one unit of k
+    void Compress() const
+    {
+        double W = 0.0;
+        for (const auto& c : scratch)
+            W += c.weight;
+        centroids.clear();
+        double Z = 4.0 * std::log(std::max(W / delta, 1.0)) + 24.0;
+        // The open centroid keeps its weighted sum; dividing per merged value would put a
+        // division on the critical path of every value
+        double curSum = scratch.front().mean * scratch.front().weight, curWeight = scratch.front().weight;
+        double soFar = 0.0;
+        double limit = W * Q(K(0.0, Z) + 1.0, Z);
+        for (std::size_t i = 1; i < scratch.size(); ++i)
+        {
+            const Centroid& next = scratch[i];
+            if (soFar + curWeight + next.weight <= limit)
+            {
+                curSum += next.mean * next.weight;
+                curWeight += next.weight;
+            }
+            else
+            {
+                soFar += curWeight;
+                centroids.push_back({ curSum / curWeight, curWeight });
+                limit = W * Q(K(soFar / W, Z) + 1.0, Z);
+                curSum = next.mean * next.weight;
+                curWeight = next.weight;
+            }
+        }
+        centroids.push_back({ curSum / curWeight, curWeight });
+    }
+
+    // LSD radix sort on the IEEE bit patterns (sign-flipped so that they order as
+    // unsigned integers), one byte per pass; passes where every key has the same byte
+    // are skipped. Only the top 32 bits are sorted on: values that tie there differ by
+    // less than 2^-20 relative, far below the resolution of any centroid, and the means
+    // still use the full values. A comparison sort of the buffer mispredicts about every
+    // other branch and cost several times more per value.
+    void SortBuffer() const
+    {
+        std::size_t n = buffer.size();
+        keys.resize(n);
+        keysTmp.resize(n);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::uint64_t u;
+            std::memcpy(&u, &buffer[i], sizeof(u));
+            keys[i] = u ^ ((u >> 63) ? ~std::uint64_t(0) : std::uint64_t(1) << 63);
+        }
+        for (int shift = 32; shift < 64; shift += 8)
+        {
+            std::size_t count[256] = {};
+            for (std::size_t i = 0; i < n; ++i)
+                ++count[(keys[i] >> shift) & 0xff];
+            if (count[(keys[0] >> shift) & 0xff] == n)
+                continue;
+            std::size_t offset = 0;
+            for (auto& c : count)
+            {
+                std::size_t k = c;
+                c = offset;
+                offset += k;
+            }
+            for (std::size_t i = 0; i < n; ++i)
+                keysTmp[count[(keys[i] >> shift) & 0xff]++] = keys[i];
+            keys.swap(keysTmp);
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::uint64_t u = keys[i] ^ ((keys[i] >> 63) ? std::uint64_t(1) << 63 : ~std::uint64_t(0));
+            std::memcpy(&buffer[i], &u, sizeof(u));
+        }
+    }
+
+    // The sorted buffer is merged linearly with the (sorted) centroids
+    void Flush() const
+    {
+        if (buffer.empty())
+            return;
+        SortBuffer();
+        scratch.resize(centroids.size() + buffer.size());
+        Centroid* out = scratch.data();
+        std::size_t i = 0;
+        for (double x : buffer)
+        {
+            for (; i < centroids.size() && centroids[i].mean <= x; ++i)
+                *out++ = centroids[i];
+            *out++ = { x, 1.0 };
+        }
+        std::copy(centroids.begin() + i, centroids.end(), out);
+        buffer.clear();
+        Compress();
+    }
+
+public:
+    // Larger delta: more centroids, smaller quantile error (roughly 1 / delta in rank)
+    explicit TDigest(double compression = 200.0)
+        : delta(compression), capacity(static_cast<std::size_t>(std::ceil(5.0 * compression)))
+    {
+        if (!(compression >= 10.0))
+            throw std::invalid_argument("TDigest: compression must be at least 10");
+        buffer.reserve(capacity);
+    }
+
+    void Add(double x)
+    {
+        if (std::isnan(x))
+            return;
+        buffer.push_back(x);
+        total += 1.0;
+        sum += x;
+        lo = std::min(lo, x);
+        hi = std::max(hi, x);
+        if (buffer.size() >= capacity)
+            Flush();
+    }
+
+    void Add(const double* x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            Add(x[i]);
+    }
+
+    void Merge(const TDigest& other)
+    {
+        Flush();
+        other.Flush();
+        if (other.centroids.empty())
+            return;
+        scratch.resize(centroids.size() + other.centroids.size());
+        std::merge(centroids.begin(), centroids.end(), other.centroids.begin(), other.centroids.end(), scratch.begin(),
+            [](const Centroid& a, const Centroid& b) { return a.mean < b.mean; });
+        Compress();
+        total += other.total;
+        sum += other.sum;
+        lo = std::min(lo, other.lo);
+        hi = std::max(hi, other.hi);
+    }
+
+    double Quantile(double q) const
+    {
+        if (total <= 0.0)
+            return std::numeric_limits<double>::quiet_NaN();
+        if (q <= 0.0)
+            return lo;
+        if (q >= 1.0)
+            return hi;
+        Flush();
+        const auto& c = centroids;
+        if (c.size() == 1)
+            return c[0].mean;
+
+        // Centroid i sits at cumulative weight cum_i + w_i / 2; the ends map to min / max
+        double index = q * total;
+        if (index < 0.5 * c[0].weight)
+            return lo + (c[0].mean - lo) * index / (0.5 * c[0].weight);
+        double cum = 0.0;
+        for (std::size_t i = 0; i + 1 < c.size(); ++i)
+        {
+            double left = cum + 0.5 * c[i].weight;
+            double right = cum + c[i].weight + 0.5 * c[i + 1].weight;
+            if (index < right)
+                return c[i].mean + (c[i + 1].mean - c[i].mean) * (index - left) / (right - left);
+            cum += c[i].weight;
+        }
+        double last = total - 0.5 * c.back().weight;
+        return c.back().mean + (hi - c.back().mean) * std::min((index - last) / (0.5 * c.back().weight), 1.0);
+    }
+
+    double Cdf(double x) const
+    {
+        if (total <= 0.0)
+            return std::numeric_limits<double>::quiet_NaN();
+        if (x < lo)
+            return 0.0;
+        if (x >= hi)
+            return 1.0;
+        Flush();
+        const auto& c = centroids;
+        if (x < c[0].mean)
+            return c[0].mean > lo ? 0.5 * c[0].weight * (x - lo) / (c[0].mean - lo) / total : 0.0;
+        double cum = 0.0;
+        for (std::size_t i = 0; i + 1 < c.size(); ++i)
+        {
+            if (x < c[i + 1].mean)
+            {
+                double left = cum + 0.5 * c[i].weight;
+                double right = cum + c[i].weight + 0.5 * c[i + 1].weight;
+                double t = c[i + 1].mean > c[i].mean ? (x - c[i].mean) / (c[i + 1].mean - c[i].mean) : 0.0;
+                return (left + t * (right - left)) / total;
+            }
+            cum += c[i].weight;
+        }
+        double last = total - 0.5 * c.back().weight;
+        return (last + 0.5 * c.back().weight * (x - c.back().mean) / (hi - c.back().mean)) / total;
+    }
+
+    double Count() const { return total; }
+    double Min() const { return lo; }
+    double Max() const { return hi; }
+    double Mean() const { return total > 0.0 ? sum / total : std::numeric_limits<double>::quiet_NaN(); }
+    double Compression() const { return delta; }
+
+    std::size_t Centroids() const
+    {
+        Flush();
+        return centroids.size();
+    }
+
+    // Reserved bytes of the centroids, the input buffer and the sort scratch; bounded by
+    // delta, not by the number of values
+    std::size_t Bytes() const
+    {
+        return (centroids.capacity() + scratch.capacity()) * sizeof(Centroid) + buffer.capacity() * sizeof(double)
+            + (keys.capacity() + keysTmp.capacity()) * sizeof(std::uint64_t);
+    }
+
+    // Layout (native byte order): magic, version, delta, count, sum, min, max, #centroids, (mean, weight)*
+    void Save(std::ostream& os) const
+    {
+        Flush();
+        SketchIo::Put(os, Magic);
+        SketchIo::Put(os, Version);
+        SketchIo::Put(os, delta);
+        SketchIo::Put(os, total);
+        SketchIo::Put(os, sum);
+        SketchIo::Put(os, lo);
+        SketchIo::Put(os, hi);
+        SketchIo::Put(os, static_cast<std::uint64_t>(centroids.size()));
+        for (const auto& c : centroids)
+        {
+            SketchIo::Put(os, c.mean);
+            SketchIo::Put(os, c.weight);
+        }
+        if (!os)
+            throw std::runtime_error("TDigest: write failed");
+    }
+
+    static TDigest Load(std::istream& is)
+    {
+        if (SketchIo::Get<std::uint32_t>(is) != Magic || SketchIo::Get<std::uint32_t>(is) != Version)
+            throw std::runtime_error("TDigest: not a version 1 t-digest");
+        TDigest d(SketchIo::Get<double>(is));
+        d.total = SketchIo::Get<double>(is);
+        d.sum = SketchIo::Get<double>(is);
+        d.lo = SketchIo::Get<double>(is);
+        d.hi = SketchIo::Get<double>(is);
+        std::uint64_t n = SketchIo::Get<std::uint64_t>(is);
+        if (n > 16 * d.capacity)
+            throw std::runtime_error("TDigest: bad centroid count");
+        d.centroids.resize(static_cast<std::size_t>(n));
+        for (auto& c : d.centroids)
+        {
+            c.mean = SketchIo::Get<double>(is);
+            c.weight = SketchIo::Get<double>(is);
+        }
+        return d;
+    }
+};
+
+class FixedHistogram
+{
+private:
+    static constexpr std::uint32_t Magic = 0x54534948;     // "HIST"
+    static constexpr std::uint32_t Version = 1;
+
+    double lo, hi, width;
+    TrackedVector<double, MemComponent::PricerState> counts;
+    double under = 0.0, over = 0.0, total = 0.0;
+    double xMin = std::numeric_limits<double>::infinity();
+    double xMax = -std::numeric_limits<double>::infinity();
+
+public:
+    FixedHistogram(double lower, double upper, int bins) : lo(lower), hi(upper), width((upper - lower) / std::max(bins, 1))
+    {
+        if (!(upper > lower) || bins < 1)
+            throw std::invalid_argument("FixedHistogram: needs lower < upper and at least one bin");
+        counts.assign(static_cast<std::size_t>(bins), 0.0);
+    }
+
+    void Add(double x)
+    {
+        if (std::isnan(x))
+            return;
+        if (x < lo)
+            under += 1.0;
+        else if (x >= hi)
+            over += 1.0;
+        else
+            counts[std::min(static_cast<std::size_t>((x - lo) / width), counts.size() - 1)] += 1.0;
+        total += 1.0;
+        xMin = std::min(xMin, x);
+        xMax = std::max(xMax, x);
+    }
+
+    void Add(const double* x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            Add(x[i]);
+    }
+
+    // Exact; both histograms must use the same grid
+    void Merge(const FixedHistogram& other)
+    {
+        if (other.lo != lo || other.hi != hi || other.counts.size() != counts.size())
+            throw std::invalid_argument("FixedHistogram: cannot merge histograms on different grids");
+        for (std::size_t b = 0; b < counts.size(); ++b)
+            counts[b] += other.counts[b];
+        under += other.under;
+        over += other.over;
+        total += other.total;
+        xMin = std::min(xMin, other.xMin);
+        xMax = std::max(xMax, other.xMax);
+    }
+
+    // Uniform within each bin; underflow spans [min, lo) and overflow [hi, max]
+    double Quantile(double q) const
+    {
+        if (total <= 0.0)
+            return std::numeric_limits<double>::quiet_NaN();
+        double index = std::min(std::max(q, 0.0), 1.0) * total;
+        if (index <= under)
+            return under > 0.0 ? xMin + (lo - xMin) * index / under : lo;
+        double cum = under;
+        for (std::size_t b = 0; b < counts.size(); ++b)
+        {
+            if (index <= cum + counts[b] && counts[b] > 0.0)
+                return lo + width * (b + (index - cum) / counts[b]);
+            cum += counts[b];
+        }
+        return over > 0.0 ? hi + (xMax - hi) * std::min((index - cum) / over, 1.0) : hi;
+    }
+
+    double Cdf(double x) const
+    {
+        if (total <= 0.0)
+            return std::numeric_limits<double>::quiet_NaN();
+        if (x < lo)
+            return x < xMin ? 0.0 : under * (x - xMin) / std::max(lo - xMin, 1e-300) / total;
+        if (x >= hi)
+            return x >= xMax ? 1.0 : (total - over + over * (x - hi) / std::max(xMax - hi, 1e-300)) / total;
+        double pos = (x - lo) / width;
+        std::size_t b = std::min(static_cast<std::size_t>(pos), counts.size() - 1);
+        double cum = under;
+        for (std::size_t i = 0; i < b; ++i)
+            cum += counts[i];
+        return (cum + counts[b] * (pos - b)) / total;
+    }
+
+    double Count() const { return total; }
+    double Underflow() const { return under; }
+    double Overflow() const { return over; }
+    int Bins() const { return static_cast<int>(counts.size()); }
+    double BinCount(int b) const { return counts.at(static_cast<std::size_t>(b)); }
+    double Lower() const { return lo; }
+    double Upper() const { return hi; }
+    std::size_t Bytes() const { return counts.capacity() * sizeof(double); }
+
+    // Layout (native byte order): magic, version, lo, hi, #bins, under, over, total, min, max, counts
+    void Save(std::ostream& os) const
+    {
+        SketchIo::Put(os, Magic);
+        SketchIo::Put(os, Version);
+        SketchIo::Put(os, lo);
+        SketchIo::Put(os, hi);
+        SketchIo::Put(os, static_cast<std::uint32_t>(counts.size()));
+        SketchIo::Put(os, under);
+        SketchIo::Put(os, over);
+        SketchIo::Put(os, total);
+        SketchIo::Put(os, xMin);
+        SketchIo::Put(os, xMax);
+        os.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(double));
+        if (!os)
+            throw std::runtime_error("FixedHistogram: write failed");
+    }
+
+    static FixedHistogram Load(std::istream& is)
+    {
+        if (SketchIo::Get<std::uint32_t>(is) != Magic || SketchIo::Get<std::uint32_t>(is) != Version)
+            throw std::runtime_error("FixedHistogram: not a version 1 histogram");
+        double lower = SketchIo::Get<double>(is);
+        double upper = SketchIo::Get<double>(is);
+        std::uint32_t bins = SketchIo::Get<std::uint32_t>(is);
+        if (bins < 1 || bins > 1u << 24)
+            throw std::runtime_error("FixedHistogram: bad bin count");
+        FixedHistogram h(lower, upper, static_cast<int>(bins));
+        h.under = SketchIo::Get<double>(is);
+        h.over = SketchIo::Get<double>(is);
+        h.total = SketchIo::Get<double>(is);
+        h.xMin = SketchIo::Get<double>(is);
+        h.xMax = SketchIo::Get<double>(is);
+        if (!is.read(reinterpret_cast<char*>(h.counts.data()), h.counts.size() * sizeof(double)))
+            throw std::runtime_error("FixedHistogram: truncated histogram");
+        return h;
+    }
+};
+
+class DistributionSketch
+{
+private:
+    static constexpr std::uint32_t Magic = 0x544b5344;     // "DSKT"
+    static constexpr std::uint32_t Version = 1;
+
+    TDigest digest;
+    std::unique_ptr<FixedHistogram> histogram;
+
+public:
+    explicit DistributionSketch(double compression = 200.0) : digest(compression) {}
+
+    DistributionSketch(const DistributionSketch& other)
+        : digest(other.digest), histogram(other.histogram ? std::make_unique<FixedHistogram>(*other.histogram) : nullptr) {}
+
+    DistributionSketch& operator=(const DistributionSketch& other)
+    {
+        digest = other.digest;
+        histogram = other.histogram ? std::make_unique<FixedHistogram>(*other.histogram) : nullptr;
+        return *this;
+    }
+
+    DistributionSketch(DistributionSketch&&) = default;
+    DistributionSketch& operator=(DistributionSketch&&) = default;
+
+    void AttachHistogram(double lower, double upper, int bins) { histogram = std::make_unique<FixedHistogram>(lower, upper, bins); }
+
+    // Same compression and histogram grid, no values
+    DistributionSketch CloneEmpty() const
+    {
+        DistributionSketch s(digest.Compression());
+        if (histogram)
+            s.AttachHistogram(histogram->Lower(), histogram->Upper(), histogram->Bins());
+        return s;
+    }
+
+    void Add(double x)
+    {
+        digest.Add(x);
+        if (histogram)
+            histogram->Add(x);
+    }
+
+    void Add(const double* x, std::size_t n)
+    {
+        digest.Add(x, n);
+        if (histogram)
+            histogram->Add(x, n);
+    }
+
+    void Merge(const DistributionSketch& other)
+    {
+        digest.Merge(other.digest);
+        if (histogram && other.histogram)
+            histogram->Merge(*other.histogram);
+        else if (histogram || other.histogram)
+            throw std::invalid_argument("DistributionSketch: cannot merge a sketch with a histogram into one without");
+    }
+
+    double Quantile(double q) const { return digest.Quantile(q); }
+    double Cdf(double x) const { return digest.Cdf(x); }
+    double Count() const { return digest.Count(); }
+    double Mean() const { return digest.Mean(); }
+
+    const TDigest& Digest() const { return digest; }
+    const FixedHistogram* Histogram() const { return histogram.get(); }
+    std::size_t Bytes() const { return digest.Bytes() + (histogram ? histogram->Bytes() : 0); }
+
+    void Save(std::ostream& os) const
+    {
+        SketchIo::Put(os, Magic);
+        SketchIo::Put(os, Version);
+        digest.Save(os);
+        SketchIo::Put(os, static_cast<std::uint32_t>(histogram ? 1 : 0));
+        if (histogram)
+            histogram->Save(os);
+    }
+
+    void Save(const std::string& fileName) const
+    {
+        std::ofstream os(fileName, std::ios::binary);
+        if (!os)
+            throw std::runtime_error("DistributionSketch: cannot open " + fileName);
+        Save(os);
+    }
+
+    static DistributionSketch Load(std::istream& is)
+    {
+        if (SketchIo::Get<std::uint32_t>(is) != Magic || SketchIo::Get<std::uint32_t>(is) != Version)
+            throw std::runtime_error("DistributionSketch: not a version 1 sketch");
+        DistributionSketch s;
+        s.digest = TDigest::Load(is);
+        if (SketchIo::Get<std::uint32_t>(is) != 0)
+            s.histogram = std::make_unique<FixedHistogram>(FixedHistogram::Load(is));
+        return s;
+    }
+
+    static DistributionSketch Load(const std::string& fileName)
+    {
+        std::ifstream is(fileName, std::ios::binary);
+        if (!is)
+            throw std::runtime_error("DistributionSketch: cannot open " + fileName);
+        return Load(is);
+    }
+
+    // sketch.count, sketch.bytes and a few quantiles, under `prefix`
+    void ReportQuantiles(RunMetrics& m, const std::string& prefix) const
+    {
+        m.Set(prefix + ".count", Count());
+        m.Set(prefix + ".bytes", static_cast<double>(Bytes()));
+        m.Set(prefix + ".p01", Quantile(0.01));
+        m.Set(prefix + ".p50", Quantile(0.5));
+        m.Set(prefix + ".p99", Quantile(0.99));
+    }
+};
+
+class SketchBatchConsumer : public IBatchConsumer, public IMetricsSource
+{ // Terminal values, or scale * payoff(S_T)
+private:
+    static constexpr std::size_t Chunk = 64;
+
+    Payoff payoff;
+    double scale;
+    DistributionSketch sketch;
+    int NT = 0;
+
+public:
+    explicit SketchBatchConsumer(double compression = 200.0) : payoff(nullptr), scale(1.0), sketch(compression) {}
+
+    SketchBatchConsumer(Payoff payoffFunction, double scaleFactor, double compression = 200.0)
+        : payoff(std::move(payoffFunction)), scale(scaleFactor), sketch(compression) {}
+
+    void AttachHistogram(double lower, double upper, int bins) { sketch.AttachHistogram(lower, upper, bins); }
+
+    void Begin(std::size_t, int numSteps) override { NT = numSteps; }
+
+    void Update(const double* x, std::size_t n, int step) override
+    {
+        if (step != NT)
+            return;
+        if (!payoff)
+        {
+            sketch.Add(x, n);
+            return;
+        }
+        double v[Chunk];
+        for (std::size_t first = 0; first < n; first += Chunk)
+        {
+            std::size_t m = std::min(Chunk, n - first);
+            for (std::size_t i = 0; i < m; ++i)
+                v[i] = scale * payoff(x[first + i]);
+            sketch.Add(v, m);
+        }
+    }
+
+    void EndTile(std::size_t) override {}
+    void End() override {}
+
+    // For per-thread engines: fold another consumer's sketch into this one
+    void Merge(const SketchBatchConsumer& other) { sketch.Merge(other.sketch); }
+
+    const DistributionSketch& Sketch() const { return sketch; }
+
+    void ReportMetrics(RunMetrics& m) const override { sketch.ReportQuantiles(m, "sketch"); }
+};
+
+class SketchingPricer : public IPricer, public IMetricsSource
+{ // Forwards to `inner` and sketches the terminal value, or scale * payoff(S_T)
+private:
+    std::shared_ptr<IPricer> inner;
+    Payoff payoff;
+    double scale;
+    DistributionSketch sketch;
+
+public:
+    explicit SketchingPricer(std::shared_ptr<IPricer> pricer, Payoff payoffFunction = nullptr, double scaleFactor = 1.0,
+        double compression = 200.0)
+        : inner(std::move(pricer)), payoff(std::move(payoffFunction)), scale(scaleFactor), sketch(compression)
+    {
+        if (!inner)
+            throw std::invalid_argument("SketchingPricer: no pricer to wrap");
+    }
+
+    void AttachHistogram(double lower, double upper, int bins) { sketch.AttachHistogram(lower, upper, bins); }
+
+    void ProcessPath(const Path& path) override
+    {
+        inner->ProcessPath(path);
+        sketch.Add(payoff ? scale * payoff(path.back()) : path.back());
+    }
+
+    void PostProcess() override { inner->PostProcess(); }
+    double DiscountFactor() const override { return inner->DiscountFactor(); }
+    double Price() const override { return inner->Price(); }
+
+    std::shared_ptr<IPricer> CloneEmpty(unsigned stream) const override
+    {
+        auto clone = std::make_shared<SketchingPricer>(inner->CloneEmpty(stream), payoff, scale);
+        clone->sketch = sketch.CloneEmpty();
+        return clone;
+    }
+
+    void Merge(const IPricer& other) override
+    {
+        const auto* o = dynamic_cast<const SketchingPricer*>(&other);
+        if (o == nullptr)
+            throw std::invalid_argument(std::string("Merge: expected SketchingPricer, got ") + typeid(other).name());
+        inner->Merge(*o->inner);
+        sketch.Merge(o->sketch);
+    }
+
+    const DistributionSketch& Sketch() const { return sketch; }
+    std::shared_ptr<IPricer> Inner() const { return inner; }
+
+    void ReportMetrics(RunMetrics& m) const override { sketch.ReportQuantiles(m, "sketch"); }
+};
+
+#endif
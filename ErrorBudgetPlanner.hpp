@@ -0,0 +1,531 @@
+/*
+ErrorBudgetPlanner.hpp
+
+Error-Budget Planner: Scheme, NT, NSim and Variance Reduction for a Target RMSE
+
+Overview:
+---------
+The `MCBuilder` prompts leave the scheme, NT and NSim to the user. A European
+price has a mean squared error of
+
+    RMSE^2 = bias(scheme, NT)^2 + Var(scheme, VR) / NSim
+
+and costs about NSim * NT * c(scheme, VR). `ErrorBudgetPlanner` estimates all
+three ingredients from a short pilot run per scheme. It then picks the cheapest
+(scheme, NT, NSim, variance reduction) that meets a target RMSE.
+
+Pilot (per scheme):
+- Levels NT0 = 1, 2, 4, ..., pilotNT. On each level, `pilotPaths` samples are
+  simulated at NT0 and at 2 NT0 on the same Brownian increments: a coarse step
+  uses (z1 + z2) / sqrt(2) of its two fine steps. Each sample is simulated
+  together with its antithetic mirror (-z).
+- Variance and the control-variate beta: from the fine paths of the last level.
+- Bias: the coupled difference D = E[P(NT0) - P(2 NT0)] has a small standard error
+  SE. With weak order p, bias(NT0) = (|D| + 2 SE) / (1 - 2^-p), an upper estimate
+  when D is noise. A level never reports less than the coarser level's bias times
+  2^-p, so a payoff whose indicator happened not to flip in the pilot is not
+  taken as exact. Beyond pilotNT the bias is extrapolated as (pilotNT / NT)^p.
+- Cost: normal generation and advanceBlock() are timed separately, giving the
+  seconds per normal and per path step.
+
+Variance reduction (VarianceReduction):
+- None
+- Antithetic          : (P(z) + P(-z)) / 2. One sample is two paths on one set of
+                        normals.
+- ControlVariate      : P - beta (df S_T - df E[S_T]), with beta fitted on the pilot.
+                        Needs PlannerContract::forward = E[S_T].
+- AntitheticControlVariate : both.
+
+Search:
+- For every scheme and VR mode, NT runs over 1, 2, 4, ..., maxNT.
+- NSim = Var / (target^2 - bias(NT)^2); NT values with bias(NT) >= target are skipped.
+- The cheapest predicted cost wins.
+- The same rules applied to the first scheme with no VR at baselineNT give the
+  "baseline" cost that the plan saves against.
+
+Execution:
+----------
+Run() executes the plan on `MCBatchEngine`: the planned scheme at NT, NSim
+samples, antithetic pairs as an engine option and the control variate in
+`EuropeanBatchConsumer`. Every VR mode the planner can choose is one the engine
+implements, so a plan can also be run by hand with the same parts.
+
+Logging:
+--------
+Run() records a PlannerDecision with the plan, the runner-up per (scheme, VR), and the
+predicted against the achieved seconds and standard error. PrintLog() writes the
+decisions as a table. ReportMetrics() publishes the totals over the book: pilot,
+predicted, achieved and baseline seconds.
+
+Usage:
+------
+```cpp
+ErrorBudgetPlanner planner;
+PlannerContract call{ "call", std::make_shared<GBM>(r, v, q, S0, T),
+    [K](double S) { return std::max(S - K, 0.0); }, std::exp(-r * T),
+    S0 * std::exp((r - q) * T), 0.01 };
+PlannerRun run = planner.Price(call);        // Plan() + Run()
+planner.PrintLog();
+```
+
+*/
+
+#ifndef ErrorBudgetPlanner_HPP
+#define ErrorBudgetPlanner_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "ImplicitFdm.hpp"
+#include "Rng.hpp"
+#include "Pricers.hpp"
+#include "Metrics.hpp"
+#include "MCBatchEngine.hpp"
+
+enum class VarianceReduction { None, Antithetic, ControlVariate, AntitheticControlVariate };
+
+inline const char* VarianceReductionName(VarianceReduction vr)
+{
+    switch (vr)
+    {
+    case VarianceReduction::Antithetic: return "antithetic";
+    case VarianceReduction::ControlVariate: return "control variate";
+    case VarianceReduction::AntitheticControlVariate: return "antithetic + CV";
+    default: return "none";
+    }
+}
+
+struct PlannerScheme
+{
+    std::string name;
+    std::function<std::shared_ptr<FdmBase>(std::shared_ptr<ISde>, int NT)> make;
+    double weakOrder = 1.0;
+};
+
+struct PlannerContract
+{
+    std::string name;
+    std::shared_ptr<ISde> sde;      // Model, spot (initial condition) and expiry
+    Payoff payoff;                  // On S_T
+    double discountFactor;
+    double forward = std::numeric_limits<double>::quiet_NaN();     // E[S_T]; NaN disables the control variate
+    double targetRmse = 0.01;
+};
+
+struct PlannerConfig
+{
+    int pilotPaths = 4000;          // Antithetic pairs per scheme and level
+    int pilotNT = 16;               // Finest pilot level (coupled with 2 * pilotNT)
+    int maxNT = 1024;
+    int minPaths = 1000;            // Lower bound on NSim
+    int baselineNT = 252;
+    unsigned seed = 2718;
+    std::function<std::shared_ptr<IRng>(unsigned seed)> rng = [](unsigned seed) {
+        return std::shared_ptr<IRng>(std::make_shared<BoxMullerNet>(seed));
+    };
+};
+
+struct PlannerPlan
+{
+    std::size_t scheme = 0;         // Index into the catalogue
+    std::string schemeName;
+    VarianceReduction vr = VarianceReduction::None;
+    int NT = 0;
+    long long NSim = 0;             // Samples; an antithetic sample is two paths
+    double beta = 0.0;              // Control-variate coefficient
+    double bias = 0.0;              // Predicted |bias| at NT
+    double stdErr = 0.0;            // Predicted
+    double seconds = 0.0;           // Predicted
+
+    double Rmse() const { return std::sqrt(bias * bias + stdErr * stdErr); }
+};
+
+struct PlannerRun
+{
+    double price = 0.0;
+    double stdErr = 0.0;
+    double seconds = 0.0;
+};
+
+struct PlannerDecision
+{
+    std::string contract;
+    double targetRmse;
+    PlannerPlan plan;
+    std::vector<PlannerPlan> candidates;    // Best NT per (scheme, VR)
+    double pilotSeconds = 0.0;
+    double baselineSeconds = 0.0;           // First scheme, no VR, baselineNT
+    PlannerRun run;
+};
+
+class ErrorBudgetPlanner : public IMetricsSource
+{
+private:
+    static constexpr std::size_t Block = 1024;     // Paths advanced per advanceBlock() call
+    static constexpr int Modes = 4;
+
+    struct PilotStats
+    {
+        double variance[Modes];             // Per sample, at the finest pilot level
+        double beta[Modes];
+        std::vector<double> bias[Modes];    // Upper estimate at NT = 1, 2, 4, ..., pilotNT
+        double secondsPerNormal, secondsPerStep;
+    };
+
+    // One coupled level: discounted payoff (y) and terminal value (x), fine / coarse, plus / minus
+    struct LevelSamples
+    {
+        std::vector<double> yf[2], yc[2], xf[2], xc[2];
+    };
+
+    PlannerConfig cfg;
+    std::vector<PlannerScheme> schemes;
+    std::vector<PlannerDecision> decisions;
+    std::vector<PlannerPlan> lastCandidates;
+    double lastPilotSeconds = 0.0, lastBaselineSeconds = 0.0;
+    unsigned runs = 0;
+
+    static double Seconds(std::chrono::steady_clock::time_point from)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+    }
+
+    static bool Antithetic(int mode) { return mode == 1 || mode == 3; }
+    static bool Control(int mode) { return mode >= 2; }
+
+    static void Moments(const std::vector<double>& x, double& mean, double& var)
+    {
+        double s = 0.0, s2 = 0.0;
+        for (double v : x)
+            s += v;
+        mean = s / x.size();
+        for (double v : x)
+            s2 += (v - mean) * (v - mean);
+        var = s2 / std::max<std::size_t>(x.size() - 1, 1);
+    }
+
+    // n samples at NT0 coupled with 2 NT0, each with its antithetic mirror
+    LevelSamples Level(const PlannerContract& c, const PlannerScheme& scheme, int NT0, IRng& rng,
+        double& rngSeconds, double& stepSeconds) const
+    {
+        auto coarse = scheme.make(c.sde, NT0);
+        auto fine = scheme.make(c.sde, 2 * NT0);
+        double x0 = c.sde->InitialCondition();
+        std::size_t n = static_cast<std::size_t>(cfg.pilotPaths);
+
+        LevelSamples out;
+        for (int s = 0; s < 2; ++s)
+        {
+            out.yf[s].resize(n);
+            out.yc[s].resize(n);
+            out.xf[s].resize(n);
+            out.xc[s].resize(n);
+        }
+
+        std::vector<double> f[2], g[2], z1(Block), z2(Block), zc(Block), m1(Block), m2(Block), mc(Block);
+        for (int s = 0; s < 2; ++s)
+        {
+            f[s].resize(Block);
+            g[s].resize(Block);
+        }
+        const double invSqrt2 = 1.0 / std::sqrt(2.0);
+
+        for (std::size_t begin = 0; begin < n; begin += Block)
+        {
+            std::size_t m = std::min(Block, n - begin);
+            for (int s = 0; s < 2; ++s)
+            {
+                std::fill(f[s].begin(), f[s].begin() + m, x0);
+                std::fill(g[s].begin(), g[s].begin() + m, x0);
+            }
+            for (int step = 0; step < NT0; ++step)
+            {
+                auto t0 = std::chrono::steady_clock::now();
+                for (std::size_t i = 0; i < m; ++i)
+                {
+                    z1[i] = rng.GenerateRn();
+                    z2[i] = rng.GenerateRn();
+                }
+                rngSeconds += Seconds(t0);
+                for (std::size_t i = 0; i < m; ++i)
+                {
+                    zc[i] = (z1[i] + z2[i]) * invSqrt2;
+                    m1[i] = -z1[i];
+                    m2[i] = -z2[i];
+                    mc[i] = -zc[i];
+                }
+
+                t0 = std::chrono::steady_clock::now();
+                double tf = fine->x[2 * step], tc = coarse->x[step];
+                fine->advanceBlock(f[0].data(), z1.data(), m, tf, fine->k);
+                fine->advanceBlock(f[0].data(), z2.data(), m, tf + fine->k, fine->k);
+                fine->advanceBlock(f[1].data(), m1.data(), m, tf, fine->k);
+                fine->advanceBlock(f[1].data(), m2.data(), m, tf + fine->k, fine->k);
+                coarse->advanceBlock(g[0].data(), zc.data(), m, tc, coarse->k);
+                coarse->advanceBlock(g[1].data(), mc.data(), m, tc, coarse->k);
+                stepSeconds += Seconds(t0);
+            }
+            for (int s = 0; s < 2; ++s)
+                for (std::size_t i = 0; i < m; ++i)
+                {
+                    out.xf[s][begin + i] = c.discountFactor * f[s][i];
+                    out.xc[s][begin + i] = c.discountFactor * g[s][i];
+                    out.yf[s][begin + i] = c.discountFactor * c.payoff(f[s][i]);
+                    out.yc[s][begin + i] = c.discountFactor * c.payoff(g[s][i]);
+                }
+        }
+        return out;
+    }
+
+    // Coupled levels NT = 1, 2, ..., pilotNT against 2 NT; statistics of every VR mode
+    PilotStats Pilot(const PlannerContract& c, const PlannerScheme& scheme, unsigned seed) const
+    {
+        auto rng = cfg.rng(seed);
+        double rngSeconds = 0.0, stepSeconds = 0.0;
+        std::vector<LevelSamples> levels;
+        double steps = 0.0;
+        for (int NT0 = 1; NT0 <= cfg.pilotNT; NT0 *= 2)
+        {
+            levels.push_back(Level(c, scheme, NT0, *rng, rngSeconds, stepSeconds));
+            steps += NT0;
+        }
+
+        std::size_t n = static_cast<std::size_t>(cfg.pilotPaths);
+        PilotStats st;
+        st.secondsPerNormal = rngSeconds / (2.0 * n * steps);
+        st.secondsPerStep = stepSeconds / (6.0 * n * steps);
+        double dfForward = c.discountFactor * c.forward;
+        double pOrder = std::pow(2.0, -scheme.weakOrder);
+        double mean, var;
+        std::vector<double> eF(n), eC(n), xF(n), xC(n), diff(n);
+
+        // Estimator of one mode on one level (beta applied when given)
+        auto estimator = [&](const LevelSamples& L, int mode, double beta) {
+            bool anti = Antithetic(mode);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                eF[i] = anti ? 0.5 * (L.yf[0][i] + L.yf[1][i]) : L.yf[0][i];
+                eC[i] = anti ? 0.5 * (L.yc[0][i] + L.yc[1][i]) : L.yc[0][i];
+                xF[i] = anti ? 0.5 * (L.xf[0][i] + L.xf[1][i]) : L.xf[0][i];
+                xC[i] = anti ? 0.5 * (L.xc[0][i] + L.xc[1][i]) : L.xc[0][i];
+            }
+            if (beta != 0.0)
+                for (std::size_t i = 0; i < n; ++i)
+                {
+                    eF[i] -= beta * (xF[i] - dfForward);
+                    eC[i] -= beta * (xC[i] - dfForward);
+                }
+        };
+
+        for (int mode = 0; mode < Modes; ++mode)
+        {
+            // beta and the variance from the fine paths of the finest level
+            st.beta[mode] = 0.0;
+            estimator(levels.back(), mode, 0.0);
+            if (Control(mode) && std::isfinite(dfForward))
+            {
+                double my, mx, vy, vx, cov = 0.0;
+                Moments(eF, my, vy);
+                Moments(xF, mx, vx);
+                for (std::size_t i = 0; i < n; ++i)
+                    cov += (eF[i] - my) * (xF[i] - mx);
+                cov /= std::max<std::size_t>(n - 1, 1);
+                st.beta[mode] = vx > 0.0 ? cov / vx : 0.0;
+                estimator(levels.back(), mode, st.beta[mode]);
+            }
+            Moments(eF, mean, st.variance[mode]);
+
+            // Bias per level, never below the coarser level's bias scaled by the weak order
+            for (std::size_t l = 0; l < levels.size(); ++l)
+            {
+                estimator(levels[l], mode, st.beta[mode]);
+                for (std::size_t i = 0; i < n; ++i)
+                    diff[i] = eC[i] - eF[i];
+                Moments(diff, mean, var);
+                double b = (std::abs(mean) + 2.0 * std::sqrt(var / n)) / (1.0 - pOrder);
+                if (l > 0)
+                    b = std::max(b, st.bias[mode].back() * pOrder);
+                st.bias[mode].push_back(b);
+            }
+        }
+        return st;
+    }
+
+    // Cheapest NT (and its NSim) for one scheme and VR mode; NT = 0 when none meets the target
+    PlannerPlan Cheapest(const PlannerContract& c, std::size_t s, int mode, const PilotStats& st, int onlyNT = 0) const
+    {
+        PlannerPlan best;
+        best.scheme = s;
+        best.schemeName = schemes[s].name;
+        best.vr = static_cast<VarianceReduction>(mode);
+        best.beta = st.beta[mode];
+        best.seconds = std::numeric_limits<double>::infinity();
+        double target2 = c.targetRmse * c.targetRmse;
+        double perSampleStep = st.secondsPerNormal + (Antithetic(mode) ? 2.0 : 1.0) * st.secondsPerStep;
+
+        for (int NT = onlyNT > 0 ? onlyNT : 1; NT <= (onlyNT > 0 ? onlyNT : cfg.maxNT); NT *= 2)
+        {
+            // Measured up to the finest pilot level, extrapolated with the weak order beyond it
+            std::size_t level = 0;
+            while ((2 << level) <= NT && level + 1 < st.bias[mode].size())
+                ++level;
+            double bias = st.bias[mode][level] * std::pow(static_cast<double>(1 << level) / NT, schemes[s].weakOrder);
+            if (bias * bias >= target2)
+                continue;
+            double paths = std::ceil(st.variance[mode] / (target2 - bias * bias));
+            long long NSim = std::max(static_cast<long long>(cfg.minPaths), static_cast<long long>(paths));
+            double seconds = static_cast<double>(NSim) * NT * perSampleStep;
+            if (seconds < best.seconds)
+            {
+                best.NT = NT;
+                best.NSim = NSim;
+                best.bias = bias;
+                best.stdErr = std::sqrt(st.variance[mode] / NSim);
+                best.seconds = seconds;
+            }
+        }
+        return best;
+    }
+
+public:
+    explicit ErrorBudgetPlanner(PlannerConfig config = PlannerConfig(), std::vector<PlannerScheme> catalogue = DefaultSchemes())
+        : cfg(std::move(config)), schemes(std::move(catalogue))
+    {
+        if (schemes.empty() || cfg.pilotPaths < 2 || cfg.pilotNT < 1 || cfg.maxNT < 1)
+            throw std::invalid_argument("ErrorBudgetPlanner: need schemes, pilotPaths >= 2, pilotNT >= 1 and maxNT >= 1");
+    }
+
+    // Ito-consistent schemes of weak order 1 (the Stratonovich predictor-corrector and Heun are
+    // left out); Log-Euler is exact for GBM, so its pilot bias is zero there
+    static std::vector<PlannerScheme> DefaultSchemes()
+    {
+        return {
+            { "Euler", [](std::shared_ptr<ISde> sde, int NT) { return std::shared_ptr<FdmBase>(std::make_shared<EulerFdm>(sde, NT)); }, 1.0 },
+            { "Milstein", [](std::shared_ptr<ISde> sde, int NT) { return std::shared_ptr<FdmBase>(std::make_shared<MilsteinFdm>(sde, NT)); }, 1.0 },
+            { "Heun2", [](std::shared_ptr<ISde> sde, int NT) { return std::shared_ptr<FdmBase>(std::make_shared<Heun2>(sde, NT)); }, 1.0 },
+            { "Log-Euler", [](std::shared_ptr<ISde> sde, int NT) { return std::shared_ptr<FdmBase>(std::make_shared<LogEulerFdm>(sde, NT)); }, 1.0 }
+        };
+    }
+
+    // Pilots every scheme and returns the cheapest plan that meets c.targetRmse
+    PlannerPlan Plan(const PlannerContract& c)
+    {
+        if (!c.sde || !c.payoff || !(c.targetRmse > 0.0))
+            throw std::invalid_argument("ErrorBudgetPlanner: the contract needs an SDE, a payoff and targetRmse > 0");
+
+        auto t0 = std::chrono::steady_clock::now();
+        bool control = std::isfinite(c.forward);
+        PlannerPlan best;
+        best.seconds = std::numeric_limits<double>::infinity();
+        lastCandidates.clear();
+        lastBaselineSeconds = std::numeric_limits<double>::infinity();
+
+        for (std::size_t s = 0; s < schemes.size(); ++s)
+        {
+            PilotStats st = Pilot(c, schemes[s], cfg.seed + 7919u * static_cast<unsigned>(s));
+            if (s == 0)
+                lastBaselineSeconds = Cheapest(c, 0, 0, st, cfg.baselineNT).seconds;
+            for (int mode = 0; mode < Modes; ++mode)
+            {
+                if (Control(mode) && !control)
+                    continue;
+                PlannerPlan p = Cheapest(c, s, mode, st);
+                if (p.NT == 0)
+                    continue;
+                lastCandidates.push_back(p);
+                if (p.seconds < best.seconds)
+                    best = p;
+            }
+        }
+        lastPilotSeconds = Seconds(t0);
+        if (best.NT == 0)
+            throw std::runtime_error("ErrorBudgetPlanner: no scheme meets the target within maxNT for " + c.name);
+        return best;
+    }
+
+    // Executes the plan on MCBatchEngine with fresh normals (antithetic pairs and the control
+    // variate through the engine and EuropeanBatchConsumer) and logs the decision, with the
+    // candidates of the last Plan() call for this contract
+    PlannerRun Run(const PlannerContract& c, const PlannerPlan& plan)
+    {
+        if (plan.NSim < 1 || plan.NSim > std::numeric_limits<int>::max())
+            throw std::invalid_argument("ErrorBudgetPlanner: plan NSim out of range for MCBatchEngine");
+
+        auto t0 = std::chrono::steady_clock::now();
+        bool anti = plan.vr == VarianceReduction::Antithetic || plan.vr == VarianceReduction::AntitheticControlVariate;
+        bool control = plan.vr == VarianceReduction::ControlVariate || plan.vr == VarianceReduction::AntitheticControlVariate;
+        double df = c.discountFactor;
+        auto european = std::make_shared<EuropeanBatchConsumer>(c.payoff, [df]() { return df; });
+        if (control)
+            european->ControlVariate(plan.beta, c.forward);
+
+        Tuple parts = std::make_tuple(c.sde, schemes.at(plan.scheme).make(c.sde, plan.NT), cfg.rng(cfg.seed + 104729u * ++runs));
+        MCBatchEngine engine(parts, { european }, static_cast<int>(plan.NSim), BatchMode::CacheBlocked, Block, anti);
+        engine.start();
+
+        PlannerRun run;
+        run.price = european->Price();
+        run.stdErr = european->StdErr();
+        run.seconds = Seconds(t0);
+
+        decisions.push_back({ c.name, c.targetRmse, plan, lastCandidates, lastPilotSeconds, lastBaselineSeconds, run });
+        lastCandidates.clear();
+        lastPilotSeconds = 0.0;
+        return run;
+    }
+
+    PlannerRun Price(const PlannerContract& c)
+    {
+        PlannerPlan plan = Plan(c);
+        return Run(c, plan);
+    }
+
+    const std::vector<PlannerDecision>& Decisions() const { return decisions; }
+
+    void PrintLog(std::ostream& os = std::cout) const
+    {
+        os << std::left << std::setw(14) << "Contract" << std::setw(21) << "Scheme" << std::setw(17) << "VR"
+            << std::right << std::setw(6) << "NT" << std::setw(10) << "NSim" << std::setw(10) << "Target"
+            << std::setw(10) << "SE pred" << std::setw(10) << "SE run" << std::setw(10) << "s pred"
+            << std::setw(10) << "s run" << std::setw(11) << "s baseline" << "\n";
+        os << std::setprecision(4);
+        for (const auto& d : decisions)
+        {
+            os << std::left << std::setw(14) << d.contract.substr(0, 13) << std::setw(21) << d.plan.schemeName.substr(0, 20)
+                << std::setw(17) << VarianceReductionName(d.plan.vr) << std::right << std::setw(6) << d.plan.NT
+                << std::setw(10) << d.plan.NSim << std::setw(10) << d.targetRmse << std::setw(10) << d.plan.stdErr
+                << std::setw(10) << d.run.stdErr << std::setw(10) << d.plan.seconds << std::setw(10) << d.run.seconds
+                << std::setw(11) << d.baselineSeconds << "\n";
+        }
+    }
+
+    void ReportMetrics(RunMetrics& m) const override
+    {
+        double pilot = 0.0, predicted = 0.0, achieved = 0.0, baseline = 0.0;
+        for (const auto& d : decisions)
+        {
+            pilot += d.pilotSeconds;
+            predicted += d.plan.seconds;
+            achieved += d.run.seconds;
+            baseline += d.baselineSeconds;
+        }
+        m.Set("planner.contracts", static_cast<double>(decisions.size()));
+        m.Set("planner.pilot_seconds", pilot);
+        m.Set("planner.predicted_seconds", predicted);
+        m.Set("planner.achieved_seconds", achieved);
+        m.Set("planner.baseline_seconds", baseline);
+    }
+};
+
+#endif
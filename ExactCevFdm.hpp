@@ -0,0 +1,127 @@
+/*
+ExactCevFdm.hpp
+
+Exact CEV Transitions via the Noncentral Chi-Square Representation
+
+Overview:
+---------
+Small-step schemes for dS = m S dt + s S^beta dW need hundreds of steps to get
+the distribution near zero right, and they can step below zero. `ExactCevFdm`
+samples the transition S(t) -> S(t + dt) exactly, for any dt, for 0 <= beta < 1.
+
+With p = 1 - beta the process X = S^(2p) solves the square-root SDE
+
+    dX = (p (2p - 1) s^2 + 2 p m X) dt + 2 p s sqrt(X) dW,
+
+a time-changed squared Bessel process of dimension delta = 2 - 1/p < 2. Writing
+b = 2 p m and C = (2 p s)^2 (e^(b dt) - 1) / (4 b) (C = (p s)^2 dt for b = 0),
+
+    X(t + dt) = C * Y,   Y = absorbed BESQ(delta) at time 1 from X(t) e^(b dt) / C,
+
+and Y is sampled exactly as a gamma/Poisson mixture (NoncentralChiSquare.hpp).
+Zero is absorbing: a path that hits zero stays there, which keeps the
+discounted price a martingale and puts the right mass at S = 0.
+
+Random numbers:
+---------------
+The transition needs gamma and Poisson variates rather than one normal. The
+scheme seeds a SplitMix64 stream from the bits of the normal it receives for
+the step, so it keeps no state: it is reentrant (pipeline step threads),
+cloneable, and paths are reproducible from the IRng seed.
+
+Usage:
+------
+Terminal payoffs need a single step per path:
+```cpp
+auto sde = std::make_shared<CEV>(r, sig, d, S0, T, 0.5);
+auto fdm = std::make_shared<ExactCevFdm>(sde, 1);     // NT = 1
+```
+`advanceBlock()` processes the batch engine's tiles with the block samplers.
+
+*/
+
+#ifndef ExactCevFdm_HPP
+#define ExactCevFdm_HPP
+
+#include <memory>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "NoncentralChiSquare.hpp"
+
+class ExactCevFdm : public FdmBase
+{
+private:
+    double p;       // 1 - beta
+    double delta;   // BESQ dimension 2 - 1/p
+    double b;       // Drift of X = S^(2p): 2 p m
+    double c2;      // Squared diffusion coefficient of X: (2 p s)^2
+
+    // C(dt) and the factor e^(b dt) / C(dt)
+    void Scale(double dt, double& C, double& growth) const
+    {
+        double e = std::exp(b * dt);
+        C = (std::abs(b) * dt < 1e-12) ? 0.25 * c2 * dt : c2 * (e - 1.0) / (4.0 * b);
+        growth = e / C;
+    }
+
+public:
+    ExactCevFdm(std::shared_ptr<CEV> stochasticEquation, int numSubdivisions)
+        : FdmBase(stochasticEquation, numSubdivisions)
+    {
+        double beta = stochasticEquation->Beta();
+        if (beta < 0.0 || beta >= 1.0)
+            throw std::invalid_argument("ExactCevFdm: requires 0 <= beta < 1");
+        p = 1.0 - beta;
+        delta = 2.0 - 1.0 / p;
+        b = 2.0 * p * stochasticEquation->NetDrift();
+        double s = stochasticEquation->LocalVolCoefficient();
+        c2 = 4.0 * p * p * s * s;
+    }
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<ExactCevFdm>(stochasticEquation);
+    }
+
+    double advance(double xn, double, double dt, double normalVar) override
+    {
+        if (xn <= 0.0)
+            return 0.0;
+        double C, growth;
+        Scale(dt, C, growth);
+        Sampling::SplitMix64 g = Sampling::FromNormal(normalVar);
+        double y = Sampling::AbsorbedBesselSquared(delta, std::pow(xn, 2.0 * p) * growth, g);
+        return (y > 0.0) ? std::pow(C * y, 0.5 / p) : 0.0;
+    }
+
+    void advanceBlock(double* xs, const double* normalVars, std::size_t n, double, double dt) override
+    {
+        double C, growth;
+        Scale(dt, C, growth);
+        const double twoP = 2.0 * p, invTwoP = 0.5 / p;
+
+        const std::size_t chunk = 256;
+        Sampling::SplitMix64 g[chunk];
+        double lambda[chunk], y[chunk];
+        for (std::size_t start = 0; start < n; start += chunk)
+        {
+            std::size_t m = std::min(chunk, n - start);
+            double* x = xs + start;
+            const double* z = normalVars + start;
+
+            for (std::size_t i = 0; i < m; ++i)
+                g[i] = Sampling::FromNormal(z[i]);
+            for (std::size_t i = 0; i < m; ++i)
+                lambda[i] = (x[i] > 0.0) ? std::pow(x[i], twoP) * growth : 0.0;
+            Sampling::AbsorbedBesselSquaredBlock(delta, lambda, g, y, m);
+            for (std::size_t i = 0; i < m; ++i)
+                x[i] = (y[i] > 0.0) ? std::pow(C * y[i], invTwoP) : 0.0;
+        }
+    }
+};
+
+#endif
@@ -24,7 +24,8 @@ Implemented Methods:
 - Euler scheme (EulerFdm)
 - Milstein scheme (MilsteinFdm, DiscreteMilsteinFdm)
 - Predictor-Corrector methods (PredictorCorrectorFdm, ModifiedPredictorCorrectorFdm,
-  MidpointPredictorCorrectorFdm, FittedMidpointPredictorCorrectorFdm)
+  MidpointPredictorCorrectorFdm, FittedMidpointPredictorCorrectorFdm,
+  GeneralizedFittedPredictorCorrectorFdm)
 - Exact solution (ExactFdm) C for lognormal SDEs
 - Higher-order schemes (Platen_01_Explicit, Heun, Heun2)
 - Derivative-free and Runge-KuttaCinspired schemes (DerivativeFree, FRKI)
@@ -40,6 +41,12 @@ Design Features:
 - The number of time subdivisions (`NT`) is used to determine step size `k`.
 - Extensible design: to implement a new FDM scheme, derive from FdmBase and override
   the `advance()` function.
+- `advanceBlock()` advances a contiguous block of paths by one step (used by the
+  batch engine); it defaults to calling `advance()` per path.
+- `Clone(sde)` copies a scheme and rebinds it to another SDE, so every worker
+  thread can own its model and scheme objects.
+- `advance()` keeps no per-call state in the scheme object, so one FDM can be
+  shared by the step threads of the pipelined engine.
 
 Usage:
 ------
@@ -57,6 +64,7 @@ use the `advance()` method within a simulation loop to generate stochastic paths
 #include <cmath>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
 class IFdm {
 public:
@@ -97,6 +105,34 @@ public:
     {
         sde = ssde;
     }
+
+protected:
+    template <typename Scheme>
+    std::shared_ptr<FdmBase> CloneAs(std::shared_ptr<ISde> stochasticEquation) const
+    {
+        auto copy = std::make_shared<Scheme>(static_cast<const Scheme&>(*this));
+        if (stochasticEquation)
+            copy->StochasticEquation(stochasticEquation);
+        return copy;
+    }
+
+public:
+
+    // Copy of the scheme (mesh and parameters) bound to another SDE, e.g. a thread-local
+    // clone of the model; nullptr keeps the current SDE. Schemes that do not override it
+    // throw, and then only the cloning mode of MCParallelEngine is unavailable.
+    virtual std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde>) const
+    {
+        throw std::logic_error("FdmBase: not cloneable");
+    }
+
+    // Advance a block of n paths by one step. The default applies advance()
+    // element-wise; schemes can override it with a tighter loop.
+    virtual void advanceBlock(double* xs, const double* normalVars, std::size_t n, double tn, double dt)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            xs[i] = advance(xs[i], tn, dt, normalVars[i]);
+    }
     
 };
 
@@ -106,6 +142,11 @@ public:
     EulerFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) :
         FdmBase(stochasticEquation, numSubdivisions) {
     }
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<EulerFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double  tn, double  dt, double normalVar) override
     {
         return xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
@@ -127,6 +168,11 @@ public:
         mu = drift;
     }
 
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<ExactFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         // Compute exact value at tn + dt.
@@ -140,6 +186,11 @@ class MilsteinFdm : public FdmBase
 public:
     MilsteinFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions) {}
 
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<MilsteinFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double  tn, double  dt, double  normalVar) override
     {
         return xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar
@@ -151,6 +202,11 @@ class DiscreteMilsteinFdm : public FdmBase
 {
 public:
     DiscreteMilsteinFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions) {}
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<DiscreteMilsteinFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         double dt1 = dt;
@@ -168,16 +224,21 @@ public:
 class PredictorCorrectorFdm : public FdmBase
 {
 private:
-    double A, B, VMid;
+    double A, B;
 public:
     PredictorCorrectorFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions, double  a, double  b)
-        : FdmBase(stochasticEquation, numSubdivisions), A(a), B(b), VMid(0.0) {
+        : FdmBase(stochasticEquation, numSubdivisions), A(a), B(b) {
+    }
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<PredictorCorrectorFdm>(stochasticEquation);
     }
 
     double advance(double  xn, double  tn, double  dt, double  normalVar) override
     {
         // Euler for predictor
-        VMid = xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
+        double VMid = xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
 
         // Modified double rapezoidal rule
         double driftdoubleTerm = (A * sde->Drift(VMid, tn + dt) + ((1.0 - A) * sde->Drift(xn, tn))) * dt;
@@ -189,20 +250,25 @@ public:
 class ModifiedPredictorCorrectorFdm : public FdmBase
 {
 private:
-    double A, B, VMid;
+    double A, B;
 
 public:
     ModifiedPredictorCorrectorFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions, double  a, double  b)
-		: FdmBase(stochasticEquation, numSubdivisions), A(a), B(b), VMid(0.0)
+		: FdmBase(stochasticEquation, numSubdivisions), A(a), B(b)
     {
         std::cout << "Modified PC" << std::endl;
     }
 
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<ModifiedPredictorCorrectorFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
 
         // Euler for predictor
-        VMid = xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
+        double VMid = xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
 
 
         // Modified Trapezoidal rule
@@ -218,20 +284,25 @@ public:
 class MidpointPredictorCorrectorFdm : public FdmBase
 {
 private:
-    double A, B, VMid;
+    double A, B;
 
 public:
     MidpointPredictorCorrectorFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions, double  a, double  b)
-		: FdmBase(stochasticEquation, numSubdivisions), A(a), B(b), VMid(0.0) 
+		: FdmBase(stochasticEquation, numSubdivisions), A(a), B(b) 
     {
         std::cout << "Midpoint Adjusted PC" << std::endl;
 	}
 
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<MidpointPredictorCorrectorFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
 
         // Euler for predictor
-        VMid = xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
+        double VMid = xn + sde->Drift(xn, tn) * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
 
 
         // Modified Trapezoidal rule
@@ -249,19 +320,25 @@ public:
 class FittedMidpointPredictorCorrectorFdm : public FdmBase
 {
 private:
-    double A, B, VMid;
+    double A, B;
 
 public:
-    FittedMidpointPredictorCorrectorFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions, double  a, double  b) : FdmBase(stochasticEquation, numSubdivisions), A(a), B(b), VMid(0.0)
+    // The fitting rate 0.08 is fixed; GeneralizedFittedPredictorCorrectorFdm reads it from the SDE
+    FittedMidpointPredictorCorrectorFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions, double  a, double  b) : FdmBase(stochasticEquation, numSubdivisions), A(a), B(b)
     {
         std::cout << "Fitted midpoint Adjusted PC" << std::endl;
     }
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<FittedMidpointPredictorCorrectorFdm>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         // Euler for predictor
         //VMid = xn + sde.Drift(xn, tn) * dt + sde.Diffusion(xn, tn) * dtSqrt * normalVar;
         double aFit = (std::exp(0.08 * dt) - 1.0) / dt;
-        VMid = xn + aFit * xn * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
+        double VMid = xn + aFit * xn * dt + sde->Diffusion(xn, tn) * dtSqrt * normalVar;
 
         // Modified Trapezoidal rule
         //   double driftTerm = (A * sde.DriftCorrected(VMid, tn + dt, B) + ((1.0 - A) * sde.DriftCorrected(xn, tn, B))) * dt;
@@ -275,6 +352,85 @@ public:
     }
 };
 
+class GeneralizedFittedPredictorCorrectorFdm : public FdmBase
+{ // Exponentially fitted drift from ISde::LinearDrift, midpoint-corrected diffusion
+private:
+    double B;
+
+    struct Fit
+    {
+        double phi;     // (e^(I1) - 1) / I1, the fitting factor
+        double I0, I1;  // Integrals of a0(t) and a1(t) over the step
+    };
+    std::vector<Fit> fits;  // One per step of the mesh
+
+    // Fitting factor of a drift a0(t) + a1(t) x over [t, t + dt], Simpson's rule in time;
+    // for a nonlinear drift the drift is linearised at (x, t)
+    Fit MakeFit(double x, double t, double dt, bool& linear) const
+    {
+        Fit f;
+        double a0[3], a1[3];
+        linear = true;
+        for (int i = 0; i < 3 && linear; ++i)
+            linear = sde->LinearDrift(t + 0.5 * i * dt, a0[i], a1[i]);
+        if (linear)
+        {
+            f.I0 = dt * (a0[0] + 4.0 * a0[1] + a0[2]) / 6.0;
+            f.I1 = dt * (a1[0] + 4.0 * a1[1] + a1[2]) / 6.0;
+        }
+        else
+        {
+            double h = 1e-6 * (1.0 + std::abs(x));
+            double slope = (sde->Drift(x + h, t) - sde->Drift(x - h, t)) / (2.0 * h);
+            f.I1 = slope * dt;
+            f.I0 = (sde->Drift(x, t) - slope * x) * dt;
+        }
+        f.phi = (std::abs(f.I1) < 1e-8) ? 1.0 + 0.5 * f.I1 : std::expm1(f.I1) / f.I1;
+        return f;
+    }
+
+public:
+    GeneralizedFittedPredictorCorrectorFdm(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions, double b = 0.5)
+        : FdmBase(stochasticEquation, numSubdivisions), B(b)
+    {
+        bool linear = true;
+        for (int n = 0; n < NT && linear; ++n)
+            fits.push_back(MakeFit(0.0, x[n], k, linear));
+        if (!linear)
+            fits.clear();
+    }
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<GeneralizedFittedPredictorCorrectorFdm>(stochasticEquation);
+    }
+
+    double advance(double xn, double tn, double dt, double normalVar) override
+    {
+        // Precomputed factors when (tn, dt) is a step of the mesh
+        Fit f;
+        long long n = std::llround(tn / k);
+        if (!fits.empty() && n >= 0 && n < NT && std::abs(x[n] - tn) <= 1e-12 * (1.0 + tn) && std::abs(dt - k) <= 1e-14 * k)
+            f = fits[n];
+        else
+        {
+            bool linear;
+            f = MakeFit(xn, tn, dt, linear);
+        }
+
+        // Fitted mean: exact for a linear drift
+        double mean = xn + f.phi * (f.I1 * xn + f.I0);
+        double b = sde->Diffusion(xn, tn);
+        double sqrtDt = std::sqrt(dt);
+
+        // Predictor, then diffusion at the B-weighted point; the -B b b' dt term
+        // removes the drift the corrector adds, keeping the mean fitted
+        double VMid = mean + b * sqrtDt * normalVar;
+        return mean + sde->Diffusion(B * VMid + (1.0 - B) * xn, tn + 0.5 * dt) * sqrtDt * normalVar
+            - B * b * sde->DiffusionDerivative(xn, tn) * dt;
+    }
+};
+
 class Platen_01_Explicit: public FdmBase
 {
 public:
@@ -284,6 +440,11 @@ public:
         std::cout << "Platen 1.0" << std::endl;
     }
 
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<Platen_01_Explicit>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         double b = sde->Diffusion(xn, tn);
@@ -302,6 +463,11 @@ public:
         : FdmBase(stochasticEquation, numSubdivisions) {
     }
 
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<Heun>(stochasticEquation);
+    }
+
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         double a = sde->Drift(xn, tn);
@@ -314,48 +480,51 @@ public:
 
 class DerivativeFree : public FdmBase
 {
-private:
-    double F1, G1, G2, addedVal, Wincr;
-    double sqrk;
-
     // Code ported from C++
 public:
-    DerivativeFree(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions), F1(0.0), G1(0.0), G2(0.0), addedVal(0.0), Wincr(0.0), sqrk(0.0){}
+    DerivativeFree(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<DerivativeFree>(stochasticEquation);
+    }
 
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         double dt1 = dt;
-        sqrk = std::sqrt(dt1);
-        Wincr = sqrk * normalVar;
+        double sqrk = std::sqrt(dt1);
+        double Wincr = sqrk * normalVar;
 
-        F1 = sde->Drift(xn, tn);
-        G1 = sde->Diffusion(xn, tn);
+        double F1 = sde->Drift(xn, tn);
+        double G1 = sde->Diffusion(xn, tn);
 
-        G2 = sde->Diffusion(xn + G1 * sqrk, tn);
-        addedVal = 0.5 * (G2 - G1) * (Wincr * Wincr - dt1) / sqrk;
+        double G2 = sde->Diffusion(xn + G1 * sqrk, tn);
+        double addedVal = 0.5 * (G2 - G1) * (Wincr * Wincr - dt1) / sqrk;
 
         return xn + (F1 * dt1 + G1 * Wincr + addedVal);
     }
 };
 class FRKI : public FdmBase
 {
-private:
-        double F1, G1, G2, addedVal, Wincr;
-		double sqrk;
 public:
-    FRKI(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions), F1(0.0), G1(0.0), G2(0.0), addedVal(0.0), Wincr(0.0), sqrk(0.0){}
+    FRKI(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<FRKI>(stochasticEquation);
+    }
 
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         double dt1 = dt;
-        sqrk = std::sqrt(dt1);
-        Wincr = sqrk * normalVar;
+        double sqrk = std::sqrt(dt1);
+        double Wincr = sqrk * normalVar;
 
         // Ported from C++
-        F1 = sde->Drift(xn, tn);
-        G1 = sde->Diffusion(xn, tn);
+        double F1 = sde->Drift(xn, tn);
+        double G1 = sde->Diffusion(xn, tn);
 
-        G2 = sde->Diffusion(xn + 0.5 * G1 * (Wincr - sqrk), tn);
+        double G2 = sde->Diffusion(xn + 0.5 * G1 * (Wincr - sqrk), tn);
 
         return xn + (F1 * k + G2 * Wincr + (G2 - G1) * sqrk);
     }
@@ -364,9 +533,6 @@ public:
 class Heun2 : public FdmBase
 {
 private:
-    double F1, F2, G1, G2, addedVal, Wincr, tmp;
-    double sqrk;
-
     double  F(double  x, double  t)
     {
         return sde->Drift(x, t) - 0.5 * sde->DiffusionDerivative(x, t) * sde->Diffusion(x, t);
@@ -374,21 +540,26 @@ private:
 
     // Code ported from C++
 public:
-    Heun2(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions), F1(0.0), F2(0.0), G1(0.0), G2(0.0), addedVal(0.0), Wincr(0.0), tmp(0.0), sqrk(0.0) {}
+    Heun2(std::shared_ptr<ISde> stochasticEquation, int numSubdivisions) : FdmBase(stochasticEquation, numSubdivisions) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<Heun2>(stochasticEquation);
+    }
 
     double advance(double xn, double tn, double dt, double normalVar) override
     {
         double dt1 = dt;
-        sqrk = std::sqrt(dt1);
-        Wincr = sqrk * normalVar;
+        double sqrk = std::sqrt(dt1);
+        double Wincr = sqrk * normalVar;
 
         // Ported from C++
-        F1 = F(xn, tn);
-        G1 = sde->Diffusion(xn, tn);
+        double F1 = F(xn, tn);
+        double G1 = sde->Diffusion(xn, tn);
 
-        tmp = xn + F1 * dt1 + G1 * Wincr;
-        F2 = F(tmp, tn);
-        G2 = sde->Diffusion(tmp, tn);
+        double tmp = xn + F1 * dt1 + G1 * Wincr;
+        double F2 = F(tmp, tn);
+        double G2 = sde->Diffusion(tmp, tn);
 
         return xn + 0.5 * (F1 + F2) * dt1 + 0.5 * (G1 + G2) * Wincr;
     }
@@ -0,0 +1,123 @@
+/*
+HestonModel.hpp
+
+Heston and Bates Model Parameters and Characteristic Functions
+
+Overview:
+---------
+    dS / S = (r - q - lambda kbar) dt + sqrt(v) dW1 + (J - 1) dN,     ln J ~ N(muJ, sigJ^2)
+    dv     = kappa (theta - v) dt + xi sqrt(v) dW2,                   dW1 dW2 = rho dt
+
+`HestonModel` holds the diffusive parameters; `BatesModel` adds compound Poisson
+lognormal jumps with intensity lambda (kbar = e^(muJ + sigJ^2 / 2) - 1 keeps the
+discounted spot a martingale). Both provide the characteristic function of
+ln(S_T / S0) - (r - q) T for `Analytics::LewisPrice` (Heston in the
+"little trap" form of Albrecher et al., which has no branch-cut jumps).
+
+The models only describe the dynamics, so pricers that need no simulation
+(AdiSolver.hpp) include this header alone; the QE path engine is in
+StochasticVolatility.hpp.
+
+Dependencies:
+-------------
+- <cmath>, <complex>, <stdexcept>, Analytics.hpp (CharacteristicFunction)
+
+*/
+
+#ifndef HestonModel_HPP
+#define HestonModel_HPP
+
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+
+#include "Analytics.hpp"
+
+class HestonModel
+{
+protected:
+    double s0, v0;
+    double rate, div;
+    double kappa, theta, xi, rho;
+    double expiry;
+
+public:
+    HestonModel(double spot, double initialVariance, double r, double q, double meanReversion, double longRunVariance,
+        double volOfVol, double correlation, double maturity)
+        : s0(spot), v0(initialVariance), rate(r), div(q), kappa(meanReversion), theta(longRunVariance),
+          xi(volOfVol), rho(correlation), expiry(maturity)
+    {
+        if (kappa <= 0.0 || xi <= 0.0 || rho < -1.0 || rho > 1.0)
+            throw std::invalid_argument("HestonModel: requires kappa > 0, xi > 0 and |rho| <= 1");
+    }
+
+    virtual ~HestonModel() = default;
+
+    double Spot() const { return s0; }
+    double InitialVariance() const { return v0; }
+    double Rate() const { return rate; }
+    double Dividend() const { return div; }
+    double Kappa() const { return kappa; }
+    double Theta() const { return theta; }
+    double Xi() const { return xi; }
+    double Rho() const { return rho; }
+    double Expiry() const { return expiry; }
+
+    // Jumps: intensity 0 for pure Heston
+    virtual double JumpIntensity() const { return 0.0; }
+    virtual double JumpMean() const { return 0.0; }
+    virtual double JumpVol() const { return 0.0; }
+
+    // Jump compensator lambda kbar (per unit time)
+    double JumpCompensator() const
+    {
+        return JumpIntensity() * (std::exp(JumpMean() + 0.5 * JumpVol() * JumpVol()) - 1.0);
+    }
+
+    virtual Analytics::CharacteristicFunction CharacteristicFunction() const
+    {
+        double k = kappa, th = theta, x = xi, p = rho, v = v0, T = expiry;
+        return [k, th, x, p, v, T](std::complex<double> u) {
+            const std::complex<double> i(0.0, 1.0);
+            std::complex<double> beta = k - p * x * i * u;
+            std::complex<double> d = std::sqrt(beta * beta + x * x * (i * u + u * u));
+            std::complex<double> g = (beta - d) / (beta + d);
+            std::complex<double> edT = std::exp(-d * T);
+            std::complex<double> C = k * th / (x * x) * ((beta - d) * T - 2.0 * std::log((1.0 - g * edT) / (1.0 - g)));
+            std::complex<double> D = (beta - d) / (x * x) * (1.0 - edT) / (1.0 - g * edT);
+            return std::exp(C + D * v);
+        };
+    }
+};
+
+class BatesModel : public HestonModel
+{
+private:
+    double lambda, muJ, sigJ;
+
+public:
+    BatesModel(double spot, double initialVariance, double r, double q, double meanReversion, double longRunVariance,
+        double volOfVol, double correlation, double maturity, double intensity, double jumpMean, double jumpVol)
+        : HestonModel(spot, initialVariance, r, q, meanReversion, longRunVariance, volOfVol, correlation, maturity),
+          lambda(intensity), muJ(jumpMean), sigJ(jumpVol)
+    {
+        if (lambda < 0.0 || sigJ < 0.0)
+            throw std::invalid_argument("BatesModel: requires lambda >= 0 and sigJ >= 0");
+    }
+
+    double JumpIntensity() const override { return lambda; }
+    double JumpMean() const override { return muJ; }
+    double JumpVol() const override { return sigJ; }
+
+    Analytics::CharacteristicFunction CharacteristicFunction() const override
+    {
+        auto heston = HestonModel::CharacteristicFunction();
+        double l = lambda, m = muJ, s = sigJ, T = expiry, kbar = std::exp(muJ + 0.5 * sigJ * sigJ) - 1.0;
+        return [heston, l, m, s, T, kbar](std::complex<double> u) {
+            const std::complex<double> i(0.0, 1.0);
+            return heston(u) * std::exp(l * T * (std::exp(i * u * m - 0.5 * s * s * u * u) - 1.0 - i * u * kbar));
+        };
+    }
+};
+
+#endif
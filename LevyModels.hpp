@@ -0,0 +1,243 @@
+/*
+LevyModels.hpp
+
+Variance Gamma and Normal Inverse Gaussian Models via Subordinated Brownian Motion
+
+Overview:
+---------
+Pure-jump Levy models for equity smiles. Both are a Brownian motion with drift
+run on a random clock (subordinator) G:
+
+    X(t) = theta G(t) + sigma W(G(t)),      S(t) = S0 exp((r - q + omega) t + X(t))
+
+- VG  : G has gamma increments with mean dt and variance nu dt,
+        omega = ln(1 - theta nu - sigma^2 nu / 2) / nu.
+- NIG : G has inverse Gaussian increments with mean dt and variance nu dt,
+        omega = -(1 - sqrt(1 - 2 theta nu - sigma^2 nu)) / nu.
+
+Both share the (sigma, nu, theta) parametrisation: sigma scales the Brownian part,
+nu the variance of the clock (kurtosis) and theta the skew. omega makes the
+discounted spot a martingale.
+
+Simulation:
+-----------
+Increments are sampled exactly for whatever dt the engine passes, so one step is
+enough for terminal payoffs and path pricers get the exact law on any grid:
+
+    dG ~ Gamma(dt / nu) * nu   or   IG(dt, dt^2 / nu),   dX = theta dG + sigma sqrt(dG) Z
+
+`VarianceGammaFdm` and `NigFdm` use the step's normal as Z and seed a SplitMix64
+from its bits for the subordinator (as ExactCevFdm.hpp does), so they stay
+stateless and reentrant. Their advanceBlock() overrides run the block samplers
+of NoncentralChiSquare.hpp: the gamma constants are computed once per block
+(the shape dt / nu is the same for every path).
+
+The models are ISde objects so that they plug into MCMediator, the batch engine
+and the pricers. Their Drift/Diffusion describe the moment-matched diffusion
+(r - q) x dt + sqrt(sigma^2 + theta^2 nu) x dW; only the two schemes below
+reproduce the jump law.
+
+Characteristic functions of X(T) (with the omega T term) are provided for
+`Analytics::LewisPrice`.
+
+Usage:
+------
+```cpp
+auto vg = std::make_shared<VarianceGamma>(r, q, 0.12, 0.2, -0.14, S0, T);
+auto fdm = std::make_shared<VarianceGammaFdm>(vg, 1);
+double ref = Analytics::LewisPrice(vg->CharacteristicFunction(), S0, K, T, r, q, 1);
+```
+
+*/
+
+#ifndef LevyModels_HPP
+#define LevyModels_HPP
+
+#include <memory>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <algorithm>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "Analytics.hpp"
+#include "NoncentralChiSquare.hpp"
+
+class SubordinatedLevyModel : public ISde
+{ // Parameters shared by VG and NIG
+protected:
+    double rate;
+    double div;
+    double sigma;
+    double nu;
+    double theta;
+    double omega;   // Martingale correction, set by the model
+
+    SubordinatedLevyModel(double r, double q, double volatility, double clockVariance, double skew,
+        double initialCondition, double expiry)
+        : rate(r), div(q), sigma(volatility), nu(clockVariance), theta(skew), omega(0.0)
+    {
+        if (sigma < 0.0 || nu <= 0.0)
+            throw std::invalid_argument("SubordinatedLevyModel: requires sigma >= 0 and nu > 0");
+        InitialCondition(initialCondition);
+        Expiry(expiry);
+    }
+
+public:
+    double Drift(double x, double) const override { return (rate - div) * x; }
+    double Diffusion(double x, double) const override { return std::sqrt(sigma * sigma + theta * theta * nu) * x; }
+    double DriftCorrected(double x, double t, double B) const override
+    {
+        return Drift(x, t) - B * Diffusion(x, t) * DiffusionDerivative(x, t);
+    }
+    double DiffusionDerivative(double, double) const override { return std::sqrt(sigma * sigma + theta * theta * nu); }
+
+    double InitialCondition() const override { return ic; }
+    void InitialCondition(double val) override { ic = val; }
+    double Expiry() const override { return exp; }
+    void Expiry(double val) override { exp = val; }
+
+    double Sigma() const { return sigma; }
+    double Nu() const { return nu; }
+    double Theta() const { return theta; }
+    double Omega() const { return omega; }
+
+    // Log-spot drift over dt, (r - q + omega) dt
+    double LogDrift(double dt) const { return (rate - div + omega) * dt; }
+};
+
+class VarianceGamma : public SubordinatedLevyModel
+{
+public:
+    VarianceGamma(double r, double q, double volatility, double clockVariance, double skew,
+        double initialCondition, double expiry)
+        : SubordinatedLevyModel(r, q, volatility, clockVariance, skew, initialCondition, expiry)
+    {
+        double arg = 1.0 - theta * nu - 0.5 * sigma * sigma * nu;
+        if (arg <= 0.0)
+            throw std::invalid_argument("VarianceGamma: requires theta nu + sigma^2 nu / 2 < 1");
+        omega = std::log(arg) / nu;
+    }
+
+    std::shared_ptr<ISde> Clone() const override { return std::make_shared<VarianceGamma>(*this); }
+
+    Analytics::CharacteristicFunction CharacteristicFunction() const
+    {
+        double s = sigma, v = nu, th = theta, w = omega, T = Expiry();
+        return [s, v, th, w, T](std::complex<double> u) {
+            const std::complex<double> i(0.0, 1.0);
+            return std::exp(i * u * w * T) * std::pow(1.0 - i * u * th * v + 0.5 * s * s * v * u * u, -T / v);
+        };
+    }
+};
+
+class NormalInverseGaussian : public SubordinatedLevyModel
+{
+public:
+    NormalInverseGaussian(double r, double q, double volatility, double clockVariance, double skew,
+        double initialCondition, double expiry)
+        : SubordinatedLevyModel(r, q, volatility, clockVariance, skew, initialCondition, expiry)
+    {
+        double arg = 1.0 - 2.0 * theta * nu - sigma * sigma * nu;
+        if (arg <= 0.0)
+            throw std::invalid_argument("NormalInverseGaussian: requires 2 theta nu + sigma^2 nu < 1");
+        omega = -(1.0 - std::sqrt(arg)) / nu;
+    }
+
+    std::shared_ptr<ISde> Clone() const override { return std::make_shared<NormalInverseGaussian>(*this); }
+
+    Analytics::CharacteristicFunction CharacteristicFunction() const
+    {
+        double s = sigma, v = nu, th = theta, w = omega, T = Expiry();
+        return [s, v, th, w, T](std::complex<double> u) {
+            const std::complex<double> i(0.0, 1.0);
+            return std::exp(i * u * w * T + (T / v) * (1.0 - std::sqrt(1.0 - 2.0 * i * u * th * v + s * s * v * u * u)));
+        };
+    }
+};
+
+class SubordinatedFdm : public FdmBase
+{ // S' = S exp(LogDrift(dt) + theta dG + sigma sqrt(dG) Z) for a clock increment dG
+protected:
+    double logDriftRate;    // r - q + omega
+    double sigma;
+    double theta;
+    double nu;
+
+    SubordinatedFdm(std::shared_ptr<SubordinatedLevyModel> model, int numSubdivisions)
+        : FdmBase(model, numSubdivisions), logDriftRate(model->LogDrift(1.0)),
+          sigma(model->Sigma()), theta(model->Theta()), nu(model->Nu()) {}
+
+    // Clock increments for n paths over dt, one generator per path
+    virtual void SampleClock(double dt, Sampling::SplitMix64* g, double* dG, std::size_t n) const = 0;
+
+public:
+    double advance(double xn, double, double dt, double normalVar) override
+    {
+        Sampling::SplitMix64 g = Sampling::FromNormal(normalVar);
+        double dG;
+        SampleClock(dt, &g, &dG, 1);
+        return xn * std::exp(logDriftRate * dt + theta * dG + sigma * std::sqrt(dG) * normalVar);
+    }
+
+    void advanceBlock(double* xs, const double* normalVars, std::size_t n, double, double dt) override
+    {
+        const double mu = logDriftRate * dt;
+        const std::size_t chunk = 256;
+        Sampling::SplitMix64 g[chunk];
+        double dG[chunk];
+        for (std::size_t start = 0; start < n; start += chunk)
+        {
+            std::size_t m = std::min(chunk, n - start);
+            double* x = xs + start;
+            const double* z = normalVars + start;
+
+            for (std::size_t i = 0; i < m; ++i)
+                g[i] = Sampling::FromNormal(z[i]);
+            SampleClock(dt, g, dG, m);
+            for (std::size_t i = 0; i < m; ++i)
+                x[i] *= std::exp(mu + theta * dG[i] + sigma * std::sqrt(dG[i]) * z[i]);
+        }
+    }
+};
+
+class VarianceGammaFdm : public SubordinatedFdm
+{
+protected:
+    void SampleClock(double dt, Sampling::SplitMix64* g, double* dG, std::size_t n) const override
+    {
+        Sampling::GammaBlock(dt / nu, g, dG, n);
+        for (std::size_t i = 0; i < n; ++i)
+            dG[i] *= nu;
+    }
+
+public:
+    VarianceGammaFdm(std::shared_ptr<VarianceGamma> model, int numSubdivisions)
+        : SubordinatedFdm(model, numSubdivisions) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<VarianceGammaFdm>(stochasticEquation);
+    }
+};
+
+class NigFdm : public SubordinatedFdm
+{
+protected:
+    void SampleClock(double dt, Sampling::SplitMix64* g, double* dG, std::size_t n) const override
+    {
+        Sampling::InverseGaussianBlock(dt, dt * dt / nu, g, dG, n);
+    }
+
+public:
+    NigFdm(std::shared_ptr<NormalInverseGaussian> model, int numSubdivisions)
+        : SubordinatedFdm(model, numSubdivisions) {}
+
+    std::shared_ptr<FdmBase> Clone(std::shared_ptr<ISde> stochasticEquation) const override
+    {
+        return CloneAs<NigFdm>(stochasticEquation);
+    }
+};
+
+#endif
@@ -0,0 +1,496 @@
+/*
+MCBatchEngine.hpp
+
+Batch (Structure-of-Arrays) Path Engine with Cache Blocking
+
+Overview:
+---------
+`MCMediator` simulates one path at a time and hands the whole path to the
+pricers. `MCBatchEngine` instead keeps the current state of many paths in a
+contiguous array and advances all of them one step at a time with
+`FdmBase::advanceBlock()`. Pricing is done by streaming consumers that update
+per-path running statistics (terminal value, running sum, barrier flag) after
+every step, so full paths are never stored.
+
+Execution modes:
+----------------
+- BatchMode::StepMajor
+    All NSim paths form a single tile: every time step streams the state,
+    normal and consumer arrays of all paths through the cache. Once these
+    arrays exceed L2 the run is bandwidth-bound.
+
+- BatchMode::CacheBlocked
+    Paths are tiled into blocks sized to stay resident in L1/L2. Each tile is
+    run through ALL time steps (normals, scheme step, consumer updates) before
+    the next tile starts, so the working set is touched NT times while it is
+    hot and memory traffic drops to one pass per tile.
+
+Both modes draw the same number of normals, but in a different order, so the
+estimates agree statistically, not bitwise.
+
+Tile size auto-tuning:
+----------------------
+On the first CacheBlocked `start()` without an explicit tile size, the engine
+reads the L1d/L2 sizes (sysconf, then sysfs, then defaults),
+derives candidate tiles from the bytes touched per path per step, times a short
+probe run for each candidate and keeps the fastest. The result is cached per
+bytes-per-path footprint for the lifetime of the process.
+
+Consumers:
+----------
+`IBatchConsumer` receives tile-relative state arrays:
+- Begin(maxTile, NT): allocate per-path state for one tile.
+- Update(x, n, step): step 0 carries the initial values.
+- EndTile(n): fold the tile into the running totals.
+- End(): finalise (e.g. discount) after the last tile.
+- PairPaths(antithetic): see below; only consumers that return true can run
+  antithetic.
+
+`EuropeanBatchConsumer`, `AsianBatchConsumer` and `BarrierBatchConsumer` mirror
+the payoffs of `EuropeanPricer`, `AsianPricer` and `BarrierPricer`, including
+their `SeasonedState` (past fixings, knock-out) for contracts valued mid-life. They are the
+std::function instantiations of BasicEuropeanBatchConsumer<PayoffPolicy,
+DiscountPolicy> etc.; with the policies of PayoffPolicies.hpp the payoff is
+evaluated over the whole tile in one inlined loop (AccumulatePayoffs) and the
+discount factor is a constant.
+
+Variance reduction:
+-------------------
+With `antitheticPairs` the engine runs NSim samples of two paths each: a tile
+of m samples advances 2 m paths, the second half on the negated normals of the
+first. `EuropeanBatchConsumer` folds the pairs into one sample and can also
+subtract a control variate on the terminal value, beta (S_T - E[S_T]), set with
+ControlVariate(beta, forward). `ErrorBudgetPlanner::Run` executes its plans
+this way.
+
+Usage:
+------
+```cpp
+auto european = std::make_shared<EuropeanBatchConsumer>(payoff, discounter);
+MCBatchEngine engine(parts, { european }, NSim, BatchMode::CacheBlocked);
+engine.start();
+std::cout << european->Price() << " +- " << european->StdErr() << std::endl;
+```
+
+*/
+
+#ifndef MCBatchEngine_HPP
+#define MCBatchEngine_HPP
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "Rng.hpp"
+#include "Pricers.hpp"
+#include "MCMediator.hpp"
+#include "Metrics.hpp"
+#include "MemoryTracker.hpp"
+
+class IBatchConsumer
+{
+public:
+    virtual void Begin(std::size_t maxTile, int NT) = 0;
+    virtual void Update(const double* x, std::size_t n, int step) = 0;
+    virtual void EndTile(std::size_t n) = 0;
+    virtual void End() = 0;
+
+    // Bytes of per-path state touched on every Update (used for tile sizing)
+    virtual std::size_t BytesPerPath() const { return 0; }
+
+    // Antithetic runs: a tile of n paths holds n / 2 samples, path i + n / 2 being the
+    // mirror of path i. Returns false when the consumer cannot fold the pairs.
+    virtual bool PairPaths(bool antithetic) { return !antithetic; }
+
+    virtual ~IBatchConsumer() = default;
+};
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicBatchPricer : public IBatchConsumer
+{ // Discounted mean and standard error of a per-path payoff
+protected:
+    PayoffPolicy m_payoff;
+    DiscountPolicy m_discounter;
+    double sum = 0.0, sum2 = 0.0;
+    long long NSim = 0;
+    double price = 0.0, stdErr = 0.0;
+
+    void Accumulate(double v)
+    {
+        sum += v;
+        sum2 += v * v;
+        ++NSim;
+    }
+
+public:
+    BasicBatchPricer(PayoffPolicy payoff, DiscountPolicy discounter)
+        : m_payoff(std::move(payoff)), m_discounter(std::move(discounter)) {}
+
+    void End() override
+    { // No paths (e.g. an empty run of another engine): price and error stay 0
+        if (NSim < 1)
+        {
+            price = stdErr = 0.0;
+            return;
+        }
+        double df = m_discounter();
+        double N = static_cast<double>(NSim);
+        double mean = sum / N;
+        price = df * mean;
+        stdErr = (NSim > 1) ? df * std::sqrt(std::max(sum2 / N - mean * mean, 0.0) / (N - 1.0)) : 0.0;
+    }
+
+    double Price() const { return price; }
+    double StdErr() const { return stdErr; }
+    long long Paths() const { return NSim; }
+};
+
+using BatchPricerBase = BasicBatchPricer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicEuropeanBatchConsumer : public BasicBatchPricer<PayoffPolicy, DiscountPolicy>
+{ // Optionally antithetic pairs and a control variate on S_T: payoff - beta (S_T - E[S_T])
+private:
+    using Base = BasicBatchPricer<PayoffPolicy, DiscountPolicy>;
+    int NT = 0;
+    bool paired = false;
+    double beta = 0.0, forward = 0.0;
+
+public:
+    BasicEuropeanBatchConsumer(PayoffPolicy payoff, DiscountPolicy discounter) : Base(std::move(payoff), std::move(discounter)) {}
+
+    // forward = E[S_T] under the simulated measure; beta = 0 switches the control off
+    void ControlVariate(double coefficient, double expectedTerminal)
+    {
+        beta = coefficient;
+        forward = expectedTerminal;
+    }
+
+    bool PairPaths(bool antithetic) override
+    {
+        paired = antithetic;
+        return true;
+    }
+
+    void Begin(std::size_t, int numSteps) override { NT = numSteps; }
+
+    void Update(const double* x, std::size_t n, int step) override
+    {
+        if (step != NT)
+            return;
+        if (!paired && beta == 0.0)
+        {
+            AccumulatePayoffs(this->m_payoff, x, n, this->sum, this->sum2);
+            this->NSim += static_cast<long long>(n);
+            return;
+        }
+        std::size_t half = paired ? n / 2 : n;
+        for (std::size_t i = 0; i < half; ++i)
+        {
+            double y = this->m_payoff(x[i]), s = x[i];
+            if (paired)
+            {
+                y = 0.5 * (y + this->m_payoff(x[i + half]));
+                s = 0.5 * (s + x[i + half]);
+            }
+            this->Accumulate(y - beta * (s - forward));
+        }
+    }
+
+    void EndTile(std::size_t) override {}
+};
+
+using EuropeanBatchConsumer = BasicEuropeanBatchConsumer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicAsianBatchConsumer : public BasicBatchPricer<PayoffPolicy, DiscountPolicy>
+{ // Arithmetic average over the NT + 1 grid values, as AsianPricer; seasoned: past fixings plus the NT values after t = 0
+private:
+    using Base = BasicBatchPricer<PayoffPolicy, DiscountPolicy>;
+    TrackedVector<double, MemComponent::PricerState> running;
+    SeasonedState past;
+    int NT = 0;
+
+public:
+    BasicAsianBatchConsumer(PayoffPolicy payoff, DiscountPolicy discounter, SeasonedState seasoned = SeasonedState())
+        : Base(std::move(payoff), std::move(discounter)), past(seasoned) {}
+
+    void Begin(std::size_t maxTile, int numSteps) override
+    {
+        NT = numSteps;
+        running.assign(maxTile, 0.0);
+    }
+
+    void Update(const double* x, std::size_t n, int step) override
+    {
+        double* acc = running.data();
+        if (step == 0)
+        {
+            double start = past.fixingSum;
+            if (past.Seasoned())
+                for (std::size_t i = 0; i < n; ++i) acc[i] = start;
+            else
+                for (std::size_t i = 0; i < n; ++i) acc[i] = x[i];
+        }
+        else
+            for (std::size_t i = 0; i < n; ++i) acc[i] += x[i];
+    }
+
+    void EndTile(std::size_t n) override
+    {
+        double inv = 1.0 / (past.Seasoned() ? past.fixingCount + NT : NT + 1.0);
+        double* acc = running.data();
+        for (std::size_t i = 0; i < n; ++i)
+            acc[i] *= inv;
+        AccumulatePayoffs(this->m_payoff, acc, n, this->sum, this->sum2);
+        this->NSim += static_cast<long long>(n);
+    }
+
+    std::size_t BytesPerPath() const override { return sizeof(double); }
+};
+
+using AsianBatchConsumer = BasicAsianBatchConsumer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicBarrierBatchConsumer : public BasicBatchPricer<PayoffPolicy, DiscountPolicy>
+{ // Up-and-out with discrete monitoring at every grid point, as BarrierPricer; seasoned: may start knocked out
+private:
+    using Base = BasicBatchPricer<PayoffPolicy, DiscountPolicy>;
+    TrackedVector<unsigned char, MemComponent::PricerState> alive;
+    double L, rebate;
+    unsigned char aliveAtStart;
+    int NT = 0;
+
+public:
+    BasicBarrierBatchConsumer(PayoffPolicy payoff, DiscountPolicy discounter, double barrier, double rebateValue = 0.0,
+        SeasonedState seasoned = SeasonedState())
+        : Base(std::move(payoff), std::move(discounter)), L(barrier), rebate(rebateValue),
+        aliveAtStart(seasoned.KnockedOutAbove(barrier) ? 0 : 1) {}
+
+    void Begin(std::size_t maxTile, int numSteps) override
+    {
+        NT = numSteps;
+        alive.assign(maxTile, 1);
+    }
+
+    void Update(const double* x, std::size_t n, int step) override
+    {
+        unsigned char* a = alive.data();
+        if (step == 0)
+            for (std::size_t i = 0; i < n; ++i) a[i] = aliveAtStart;
+        for (std::size_t i = 0; i < n; ++i)
+            a[i] &= static_cast<unsigned char>(x[i] < L);
+        if (step == NT)
+            for (std::size_t i = 0; i < n; ++i)
+                this->Accumulate(a[i] ? this->m_payoff(x[i]) : rebate);
+    }
+
+    void EndTile(std::size_t) override {}
+
+    std::size_t BytesPerPath() const override { return sizeof(unsigned char); }
+};
+
+using BarrierBatchConsumer = BasicBarrierBatchConsumer<Payoff, Discounter>;
+
+enum class BatchMode { StepMajor, CacheBlocked };
+
+class MCBatchEngine : public IMetricsSource
+{
+private:
+    std::shared_ptr<ISde> sde;
+    std::shared_ptr<FdmBase> fdm;
+    std::shared_ptr<IRng> rng;
+    std::vector<std::shared_ptr<IBatchConsumer>> consumers;
+    int NSim;
+    BatchMode mode;
+    std::size_t tile;
+    bool antithetic;
+    double elapsed = 0.0;
+
+    TrackedVector<double, MemComponent::PathBuffer> x;
+    TrackedVector<double, MemComponent::RngPool> z;
+
+    std::size_t BytesPerPath() const
+    {
+        std::size_t bytes = 2 * sizeof(double); // state + normal
+        for (const auto& c : consumers)
+            bytes += c->BytesPerPath();
+        return bytes;
+    }
+
+    // Runs `count` samples starting at tile granularity `tileSize` through NT steps; an
+    // antithetic tile of m samples advances 2 m paths, the second half on the negated normals
+    void RunTiles(std::size_t count, std::size_t tileSize, int NT, bool mirror = false)
+    {
+        double x0 = sde->InitialCondition();
+        double k = fdm->k;
+
+        for (std::size_t first = 0; first < count; first += tileSize)
+        {
+            std::size_t m = std::min(tileSize, count - first);
+            std::size_t n = mirror ? 2 * m : m;
+            double* xs = x.data();
+            double* zs = z.data();
+
+            std::fill(xs, xs + n, x0);
+            for (auto& c : consumers)
+                c->Update(xs, n, 0);
+
+            for (int step = 1; step <= NT; ++step)
+            {
+                for (std::size_t i = 0; i < m; ++i)
+                    zs[i] = rng->GenerateRn();
+                if (mirror)
+                    for (std::size_t i = 0; i < m; ++i)
+                        zs[m + i] = -zs[i];
+                fdm->advanceBlock(xs, zs, n, fdm->x[step - 1], k);
+                for (auto& c : consumers)
+                    c->Update(xs, n, step);
+            }
+
+            for (auto& c : consumers)
+                c->EndTile(n);
+        }
+    }
+
+    static std::size_t CacheSize(int level)
+    {
+        long bytes = 0;
+#if defined(_SC_LEVEL1_DCACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+        bytes = sysconf(level == 1 ? _SC_LEVEL1_DCACHE_SIZE : _SC_LEVEL2_CACHE_SIZE);
+#endif
+        if (bytes <= 0)
+        { // sysfs: index0 = L1d, index2 = L2 on common x86/ARM layouts
+            std::ifstream in(std::string("/sys/devices/system/cpu/cpu0/cache/index") + (level == 1 ? "0" : "2") + "/size");
+            std::string s;
+            if (in >> s && !s.empty())
+            {
+                bytes = std::stol(s);
+                char unit = s.back();
+                if (unit == 'K') bytes *= 1024;
+                if (unit == 'M') bytes *= 1024 * 1024;
+            }
+        }
+        if (bytes <= 0)
+            bytes = (level == 1) ? 32 * 1024 : 1024 * 1024;
+        return static_cast<std::size_t>(bytes);
+    }
+
+    std::size_t TuneTileSize()
+    {
+        std::size_t bpp = BytesPerPath();
+        static std::mutex guard;
+        static std::map<std::size_t, std::size_t> tuned;
+
+        std::lock_guard<std::mutex> lock(guard);
+        auto it = tuned.find(bpp);
+        if (it != tuned.end())
+            return it->second;
+
+        std::size_t L1 = CacheSize(1), L2 = CacheSize(2);
+        std::vector<std::size_t> candidates = { L1 / (2 * bpp), L1 / bpp, L2 / (4 * bpp), L2 / (2 * bpp), L2 / bpp };
+        for (auto& c : candidates)
+            c = std::max<std::size_t>(64, c & ~std::size_t(7));
+
+        // Probe: a few tiles of each candidate on a short horizon, with scratch
+        // consumers and RNG so the user's random stream is left untouched
+        auto savedConsumers = consumers;
+        auto savedRng = rng;
+        consumers.clear();
+        rng = std::make_shared<BoxMullerNet>(12345u);
+        int probeSteps = std::min(fdm->NT, 32);
+        std::size_t best = candidates.front();
+        double bestRate = 0.0;
+        for (std::size_t c : candidates)
+        {
+            x.resize(c);
+            z.resize(c);
+            std::size_t count = std::max<std::size_t>(4 * c, 8192);
+            auto t0 = std::chrono::steady_clock::now();
+            RunTiles(count, c, probeSteps);
+            double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            double rate = count / std::max(secs, 1.0e-9);
+            if (rate > bestRate)
+            {
+                bestRate = rate;
+                best = c;
+            }
+        }
+        consumers = savedConsumers;
+        rng = savedRng;
+
+        tuned[bpp] = best;
+        return best;
+    }
+
+public:
+    // antithetic: NSim samples of two mirrored paths each; every consumer must accept the pairs
+    MCBatchEngine(Tuple parts, std::vector<std::shared_ptr<IBatchConsumer>> batchConsumers, int numberSimulations,
+        BatchMode batchMode = BatchMode::CacheBlocked, std::size_t tilePaths = 0, bool antitheticPairs = false)
+        : sde(std::get<0>(parts)), fdm(std::get<1>(parts)), rng(std::get<2>(parts)),
+        consumers(std::move(batchConsumers)), NSim(numberSimulations), mode(batchMode), tile(tilePaths),
+        antithetic(antitheticPairs)
+    {
+        if (NSim < 1)
+            throw std::invalid_argument("MCBatchEngine: requires NSim >= 1");
+        for (auto& c : consumers)
+            if (!c->PairPaths(antithetic))
+                throw std::invalid_argument("MCBatchEngine: a consumer does not support antithetic pairs");
+    }
+
+    void start()
+    {
+        std::size_t count = static_cast<std::size_t>(NSim);
+        std::size_t tileSize = count;
+        if (mode == BatchMode::CacheBlocked)
+        {
+            if (tile == 0)
+                tile = TuneTileSize();
+            // The tile counts paths; an antithetic sample is two of them
+            tileSize = std::min(antithetic ? tile / 2 : tile, count);
+        }
+        tileSize = std::max<std::size_t>(tileSize, 1);
+
+        auto t0 = std::chrono::steady_clock::now();
+        std::size_t paths = antithetic ? 2 * tileSize : tileSize;
+        x.resize(paths);
+        z.resize(paths);
+        for (auto& c : consumers)
+            c->Begin(paths, fdm->NT);
+
+        RunTiles(count, tileSize, fdm->NT, antithetic);
+
+        for (auto& c : consumers)
+            c->End();
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Paths per tile used by the last start() (NSim in step-major mode)
+    std::size_t TileSize() const { return mode == BatchMode::CacheBlocked ? std::min<std::size_t>(tile, NSim) : NSim; }
+
+    double ElapsedTime() const { return elapsed; }
+
+    void ReportMetrics(RunMetrics& m) const override
+    {
+        m.Set("engine.seconds", elapsed);
+        m.Set("engine.paths", NSim);
+        m.Set("engine.tile_paths", static_cast<double>(TileSize()));
+        MemoryTracker::ReportMetrics(m);
+    }
+};
+
+#endif
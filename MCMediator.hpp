@@ -18,6 +18,10 @@ Core Responsibilities:
 - Emit each simulated path via a signal (`path`).
 - Notify completion of all simulations via a signal (`finish`).
 - Periodically log simulation progress via a signal (`mis`).
+- Report elapsed time and the memory footprint (tracked buffers, peak RSS) per run.
+- Optionally run as a pipeline (`start(PipelineConfig)`): RNG, stepping and payoff
+  stages on separate threads connected by lock-free ring buffers, with per-stage
+  timings (see MCPipeline.hpp). Pricers receive the same paths in the same order.
 
 Design Features:
 ----------------
@@ -47,6 +51,8 @@ Type Aliases:
 #include "Fdm.hpp"
 #include "Rng.hpp"
 #include "StopWatch.hpp"
+#include "MemoryTracker.hpp"
+#include "MCPipeline.hpp"
 #include "boost/signals2.hpp"
 
 // Events
@@ -67,6 +73,8 @@ private:
 	std::shared_ptr<IRng> rng;
 	int NSim;
 	std::vector<double> res;
+	std::vector<PipelineStageStats> stageStats;
+	double pipelineTime = 0.0;
 
 	// C# code use events
 	//private event PathEvent<double> path;            // Signal to the Pricers
@@ -122,6 +130,7 @@ public:
 		double VOld, VNew;
 		
 		StopWatch sw;
+		TrackedBytes pathBytes(MemComponent::PathBuffer, res.capacity() * sizeof(double));
 		sw.StartStopWatch();
 		for (int i = 0; i < NSim; ++i)
 		{
@@ -145,7 +154,27 @@ public:
 		finish();
 		sw.StopStopWatch();
 		std::cout << "Time elapsed:" << sw.GetTime() << "s\n";
+		MemoryTracker::Print(std::cout);
 	}
+
+	void start(const PipelineConfig& config)
+	{ // Pipelined event loop: RNG, stepping and payoff stages overlap
+		MCPipeline pipeline(config);
+		pipeline.Run(sde, fdm, rng, NSim,
+			[this](const std::vector<double>& p) { path(p); },
+			[this](int i) { mis(i); });
+		finish();
+
+		stageStats = pipeline.Stages();
+		pipelineTime = pipeline.ElapsedTime();
+		std::cout << "Time elapsed:" << pipelineTime << "s\n";
+		pipeline.Print(std::cout);
+		MemoryTracker::Print(std::cout);
+	}
+
+	// Stage timings and wall time of the last pipelined start()
+	const std::vector<PipelineStageStats>& StageStats() const { return stageStats; }
+	double PipelineTime() const { return pipelineTime; }
 };
 
 
@@ -0,0 +1,233 @@
+/*
+MCParallelEngine.hpp
+
+Multithreaded Monte Carlo Path Generation
+
+Overview:
+---------
+`MCParallelEngine` runs the same path loop as `MCMediator::start()` on several
+threads. NSim is split into contiguous shares, one per worker, and every worker
+owns a complete, independent set of simulation parts:
+
+- its own SDE / FDM / RNG tuple (no shared mutable state on the hot path),
+- its own path buffer,
+- its own path and end-of-simulation slots (typically bound to a private pricer).
+
+Workers are created by a user-supplied factory, so the engine does not need to
+know the concrete pricer or RNG types. Seeding each worker's RNG from its id keeps
+runs reproducible for a fixed thread count.
+
+The factory is called on the worker's own thread, after the optional
+`WorkerPlacement` has pinned it. Everything the worker allocates (parts, path
+buffer, pricer accumulators) is therefore first touched on its local NUMA node.
+The factory must be safe to call concurrently for different ids.
+
+End-of-simulation slots are invoked on the calling thread, in worker order, after
+all threads have joined. Pricers can therefore print or merge results there
+without any locking.
+
+An exception thrown by a worker (the factory, a clone or a path slot) is captured
+on its thread. start() rethrows the first one, in worker order, on the calling
+thread after the join; no end-of-simulation slot runs in that case.
+
+Cloning mode:
+-------------
+Given a prototype SDE, FDM and pricer, the engine builds the workers itself:
+each worker gets `sde->Clone()`, `fdm->Clone(sdeClone)`, an RNG from the RNG
+factory and `pricer->CloneEmpty(id)`. A prototype without these overrides makes
+start() throw the base class's std::logic_error. After the join the clones are merged into
+the prototype pricer in worker order and its `PostProcess()` runs once, so any
+`IPricer` scales without locks and the result is read from the prototype.
+
+Metrics:
+--------
+The engine is an `IMetricsSource`: it reports engine.seconds, engine.paths,
+engine.threads and the memory tracker figures (per-worker path buffers are booked
+under MemComponent::PathBuffer).
+
+Usage:
+------
+```cpp
+std::vector<std::shared_ptr<EuropeanPricer>> pricers(nThreads);
+MCParallelEngine engine([&](int id) {
+    auto sde = std::make_shared<GBM>(r, v, d, IC, T);
+    auto fdm = std::make_shared<EulerFdm>(sde, NT);
+    auto rng = std::make_shared<BoxMullerNet>(1234u + id);
+    pricers[id] = std::make_shared<EuropeanPricer>(payoff, discounter);
+    auto op = pricers[id];
+    return MCWorker{ std::make_tuple(sde, fdm, rng),
+        [op](const std::vector<double>& path) { op->ProcessPath(path); },
+        [op]() { op->PostProcess(); } };
+}, NSim, nThreads);
+engine.start();
+
+// Cloning mode: any IPricer, merged into `pricer` at the end
+MCParallelEngine cloned(sde, fdm, [](int id) { return std::make_shared<BoxMullerNet>(1234u + id); },
+    pricer, NSim, nThreads);
+cloned.start();
+double price = pricer->Price();
+```
+
+*/
+
+#ifndef MCParallelEngine_HPP
+#define MCParallelEngine_HPP
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "Rng.hpp"
+#include "MCMediator.hpp"
+#include "Pricers.hpp"
+#include "Metrics.hpp"
+#include "MemoryTracker.hpp"
+#include "WorkerPlacement.hpp"
+
+struct MCWorker
+{
+    Tuple parts;
+    PathEvent path;
+    EndOfSimulation finish;
+};
+
+using MCWorkerFactory = std::function<MCWorker(int workerId)>;
+using MCRngFactory = std::function<std::shared_ptr<IRng>(int workerId)>;
+
+class MCParallelEngine : public IMetricsSource
+{
+private:
+    MCWorkerFactory factory;
+    int NSim;
+    int nThreads;
+    double elapsed;
+    WorkerPlacement placement;
+    std::vector<int> shares;
+    std::function<void()> complete;     // Runs after all end-of-simulation slots
+
+    static void RunPaths(MCWorker& worker, int count)
+    {
+        auto sde = std::get<0>(worker.parts);
+        auto fdm = std::get<1>(worker.parts);
+        auto rng = std::get<2>(worker.parts);
+
+        std::vector<double> res(fdm->NT + 1);
+        TrackedBytes resBytes(MemComponent::PathBuffer, res.capacity() * sizeof(double));
+        double VOld, VNew;
+        for (int i = 0; i < count; ++i)
+        {
+            VOld = sde->InitialCondition();
+            res[0] = VOld;
+            for (std::size_t n = 1; n < res.size(); n++)
+            {
+                VNew = fdm->advance(VOld, fdm->x[n - 1], fdm->k, rng->GenerateRn());
+                res[n] = VNew;
+                VOld = VNew;
+            }
+            worker.path(res);
+        }
+    }
+
+public:
+    MCParallelEngine(MCWorkerFactory workerFactory, int numberSimulations, int threads = 0,
+        WorkerPlacement workerPlacement = WorkerPlacement(WorkerPlacement::Policy::None))
+        : factory(std::move(workerFactory)), NSim(numberSimulations), elapsed(0.0), placement(std::move(workerPlacement))
+    {
+        nThreads = threads > 0 ? threads : static_cast<int>(std::thread::hardware_concurrency());
+        nThreads = std::max(1, std::min(nThreads, std::max(1, NSim)));
+        shares = placement.Partition(NSim, nThreads);
+    }
+
+    // Cloning mode: per-worker copies of the prototype SDE/FDM/pricer, merged into `pricer`
+    MCParallelEngine(std::shared_ptr<ISde> sde, std::shared_ptr<FdmBase> fdm, MCRngFactory rngs,
+        std::shared_ptr<IPricer> pricer, int numberSimulations, int threads = 0,
+        WorkerPlacement workerPlacement = WorkerPlacement(WorkerPlacement::Policy::None))
+        : MCParallelEngine(MCWorkerFactory(), numberSimulations, threads, std::move(workerPlacement))
+    {
+        auto clones = std::make_shared<std::vector<std::shared_ptr<IPricer>>>(nThreads);
+        factory = [sde, fdm, rngs, pricer, clones](int id) {
+            auto localSde = sde->Clone();
+            auto op = pricer->CloneEmpty(static_cast<unsigned>(id));
+            (*clones)[id] = op;
+            return MCWorker{ std::make_tuple(localSde, fdm->Clone(localSde), rngs(id)),
+                [op](const std::vector<double>& path) { op->ProcessPath(path); },
+                []() {} };
+        };
+        complete = [pricer, clones]() {
+            for (const auto& op : *clones)
+                pricer->Merge(*op);
+            pricer->PostProcess();
+        };
+    }
+
+    int Threads() const { return nThreads; }
+
+    // Number of paths simulated by worker `id` (topology-aware split of NSim)
+    int Share(int id) const
+    {
+        return shares[id];
+    }
+
+    void start()
+    {
+        auto t0 = std::chrono::steady_clock::now();
+
+        std::vector<MCWorker> workers(nThreads);
+        std::vector<std::exception_ptr> errors(nThreads);
+        auto run = [this, &workers, &errors](int id) {
+            try
+            {
+                placement.Apply(id);
+                workers[id] = factory(id);
+                RunPaths(workers[id], Share(id));
+            }
+            catch (...)
+            {
+                errors[id] = std::current_exception();
+            }
+        };
+
+        if (nThreads == 1 && placement.PlacementPolicy() == WorkerPlacement::Policy::None)
+            run(0); // Nothing to place: stay on the calling thread
+        else
+        {
+            std::vector<std::thread> pool;
+            for (int id = 0; id < nThreads; ++id)
+                pool.emplace_back(run, id);
+            for (auto& th : pool)
+                th.join();
+        }
+
+        // The first worker error (in worker order) is rethrown on the calling thread
+        for (const auto& e : errors)
+            if (e)
+                std::rethrow_exception(e);
+
+        for (auto& w : workers)
+            w.finish();
+        if (complete)
+            complete();
+
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+    // Wall time of the last start() in seconds
+    double ElapsedTime() const { return elapsed; }
+
+    void ReportMetrics(RunMetrics& m) const override
+    {
+        m.Set("engine.seconds", elapsed);
+        m.Set("engine.paths", NSim);
+        m.Set("engine.threads", nThreads);
+        m.Set("engine.numa_nodes", placement.PlacementPolicy() == WorkerPlacement::Policy::None ? 0 : placement.NodesUsed());
+        MemoryTracker::ReportMetrics(m);
+    }
+};
+
+#endif
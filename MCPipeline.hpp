@@ -0,0 +1,319 @@
+/*
+MCPipeline.hpp
+
+Pipelined Path Generation: RNG, Stepping and Payoff Stages
+
+Overview:
+---------
+`MCMediator::start()` interleaves random number generation, `FdmBase::advance()`
+and the pricers' `ProcessPath()` for every path, so the three code paths keep
+evicting each other from the instruction cache and cannot overlap. `MCPipeline`
+runs them as separate stages that exchange blocks of paths:
+
+    [RNG] --normals--> [Step x stepThreads] --paths--> [Payoff]
+      ^                                                    |
+      +------------------------ free blocks ---------------+
+
+- RNG stage (1 thread): draws the normals of a block of `blockPaths` paths, in
+  exactly the order the sequential loop would draw them. IRng objects are
+  stateful, so this stage is never split.
+- Step stage (`stepThreads` threads): turns the normals into paths with
+  `FdmBase::advance()`. Several threads share the FDM, so its advance() must be
+  reentrant (all schemes in Fdm.hpp are).
+- Payoff stage (the calling thread): restores block order and emits every path
+  to the path slot, so pricers see the same paths in the same order as with
+  `MCMediator::start()` and need no locking.
+
+Blocks are preallocated (`queueBlocks` of them) and recycled through the free
+ring, so memory is bounded and a slow stage stalls its producers (back-pressure)
+instead of growing queues. Single-producer/single-consumer links use SpscRing,
+links shared by several step threads use MpmcRing (RingBuffer.hpp).
+
+Stage timings:
+--------------
+For every stage the pipeline records busy time, time waiting for input
+(starved) and time waiting for output space (blocked), summed over its threads.
+A stage with high utilization and little waiting is the bottleneck: give it more
+threads (step stage) or cheaper work; stages that mostly wait have too many.
+The figures are printed by Print() and published as pipeline.<stage>.* metrics.
+
+Usage:
+------
+```cpp
+PipelineConfig config;
+config.stepThreads = 2;
+MCMediator mcp(parts, pricer->path, pricer->finish, NSim);
+mcp.start(config);                  // instead of mcp.start()
+for (const auto& s : mcp.StageStats())
+    std::cout << s.name << " " << s.Utilization(mcp.PipelineTime()) << "\n";
+```
+
+*/
+
+#ifndef MCPipeline_HPP
+#define MCPipeline_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "Rng.hpp"
+#include "RingBuffer.hpp"
+#include "Metrics.hpp"
+#include "MemoryTracker.hpp"
+
+struct PipelineConfig
+{
+    int stepThreads = 1;    // Threads in the stepping stage
+    int blockPaths = 64;    // Paths per block
+    int queueBlocks = 0;    // Blocks in flight; 0: 2 * stepThreads + 2
+};
+
+struct PipelineStageStats
+{
+    std::string name;
+    int threads = 0;
+    long long blocks = 0;
+    double busy = 0.0;      // Seconds doing work (summed over threads)
+    double waitIn = 0.0;    // Seconds starved for input
+    double waitOut = 0.0;   // Seconds blocked on a full output / no free block
+
+    double Utilization(double wallSeconds) const
+    {
+        return (wallSeconds > 0.0 && threads > 0) ? busy / (wallSeconds * threads) : 0.0;
+    }
+};
+
+class MCPipeline : public IMetricsSource
+{
+private:
+    PipelineConfig config;
+    std::vector<PipelineStageStats> stats;
+    double elapsed;
+
+    class BlockQueue
+    { // SPSC when both ends are single threads, MPMC otherwise
+    private:
+        std::unique_ptr<SpscRing<int>> spsc;
+        std::unique_ptr<MpmcRing<int>> mpmc;
+
+    public:
+        BlockQueue(std::size_t capacity, bool shared)
+        {
+            if (shared)
+                mpmc.reset(new MpmcRing<int>(capacity));
+            else
+                spsc.reset(new SpscRing<int>(capacity));
+        }
+
+        double Push(int block) { return spsc ? spsc->Push(block) : mpmc->Push(block); }
+        double Pop(int& block) { return spsc ? spsc->Pop(block) : mpmc->Pop(block); }
+    };
+
+    struct Block
+    {
+        long long seq = 0;                          // Block number; paths [seq * blockPaths, ...)
+        int count = 0;
+        TrackedVector<double, MemComponent::RngPool> z;  // count x NT normals, path-major
+        std::vector<std::vector<double>> paths;     // count paths of NT + 1 values
+    };
+
+    static double Seconds(std::chrono::steady_clock::time_point t0)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+
+public:
+    explicit MCPipeline(PipelineConfig pipelineConfig = PipelineConfig()) : config(pipelineConfig), elapsed(0.0)
+    {
+        config.stepThreads = std::max(1, config.stepThreads);
+        config.blockPaths = std::max(1, config.blockPaths);
+        if (config.queueBlocks <= 0)
+            config.queueBlocks = 2 * config.stepThreads + 2;
+        config.queueBlocks = std::max(config.queueBlocks, config.stepThreads + 1);
+    }
+
+    const PipelineConfig& Config() const { return config; }
+
+    // Simulates NSim paths and hands each one to emit() on the calling thread, in order.
+    // progress(i) is called before path i whenever i is a multiple of 100.
+    void Run(std::shared_ptr<ISde> sde, std::shared_ptr<FdmBase> fdm, std::shared_ptr<IRng> rng, int NSim,
+        const std::function<void(const std::vector<double>&)>& emit, const std::function<void(int)>& progress = nullptr)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+
+        const int NT = fdm->NT;
+        const int B = config.blockPaths;
+        const int nStep = config.stepThreads;
+        const long long nBlocks = (static_cast<long long>(std::max(0, NSim)) + B - 1) / B;
+        const int pool = static_cast<int>(std::min<long long>(config.queueBlocks, std::max(1LL, nBlocks)));
+
+        std::vector<Block> blocks(pool);
+        for (auto& blk : blocks)
+        {
+            blk.z.resize(static_cast<std::size_t>(B) * NT);
+            blk.paths.assign(B, std::vector<double>(NT + 1));
+        }
+        TrackedBytes pathBytes(MemComponent::PathBuffer, static_cast<std::size_t>(pool) * B * (NT + 1) * sizeof(double));
+
+        const std::size_t capacity = static_cast<std::size_t>(pool + nStep);
+        BlockQueue freeBlocks(capacity, false);
+        BlockQueue normals(capacity, nStep > 1);
+        BlockQueue done(capacity, nStep > 1);
+        for (int i = 0; i < pool; ++i)
+            freeBlocks.Push(i);
+
+        stats.assign(3, PipelineStageStats());
+        stats[0].name = "rng";
+        stats[0].threads = 1;
+        stats[1].name = "step";
+        stats[1].threads = nStep;
+        stats[2].name = "payoff";
+        stats[2].threads = 1;
+        std::vector<PipelineStageStats> stepStats(nStep);
+
+        std::thread rngStage([&]() {
+            PipelineStageStats& st = stats[0];
+            for (long long b = 0; b < nBlocks; ++b)
+            {
+                int idx;
+                st.waitOut += freeBlocks.Pop(idx);
+                auto ts = std::chrono::steady_clock::now();
+                Block& blk = blocks[idx];
+                blk.seq = b;
+                blk.count = static_cast<int>(std::min<long long>(B, NSim - b * B));
+                std::size_t n = static_cast<std::size_t>(blk.count) * NT;
+                for (std::size_t i = 0; i < n; ++i)
+                    blk.z[i] = rng->GenerateRn();
+                st.busy += Seconds(ts);
+                ++st.blocks;
+                st.waitOut += normals.Push(idx);
+            }
+            for (int s = 0; s < nStep; ++s)
+                st.waitOut += normals.Push(-1); // One stop marker per step thread
+        });
+
+        std::vector<std::thread> stepStage;
+        for (int w = 0; w < nStep; ++w)
+        {
+            stepStage.emplace_back([&, w]() {
+                PipelineStageStats& st = stepStats[w];
+                for (;;)
+                {
+                    int idx;
+                    st.waitIn += normals.Pop(idx);
+                    if (idx < 0)
+                        break;
+                    auto ts = std::chrono::steady_clock::now();
+                    Block& blk = blocks[idx];
+                    const double* z = blk.z.data();
+                    for (int j = 0; j < blk.count; ++j, z += NT)
+                    {
+                        std::vector<double>& res = blk.paths[j];
+                        double VOld = sde->InitialCondition();
+                        res[0] = VOld;
+                        for (int n = 1; n <= NT; ++n)
+                        {
+                            VOld = fdm->advance(VOld, fdm->x[n - 1], fdm->k, z[n - 1]);
+                            res[n] = VOld;
+                        }
+                    }
+                    st.busy += Seconds(ts);
+                    ++st.blocks;
+                    st.waitOut += done.Push(idx);
+                }
+            });
+        }
+
+        { // Payoff stage: reorder by block number, emit, recycle
+            PipelineStageStats& st = stats[2];
+            std::vector<int> arrived(pool, -1); // In-flight blocks lie in [next, next + pool)
+            for (long long next = 0; next < nBlocks; )
+            {
+                int slot = static_cast<int>(next % pool);
+                if (arrived[slot] < 0)
+                {
+                    int idx;
+                    st.waitIn += done.Pop(idx);
+                    arrived[static_cast<int>(blocks[idx].seq % pool)] = idx;
+                    continue;
+                }
+                int idx = arrived[slot];
+                arrived[slot] = -1;
+
+                auto ts = std::chrono::steady_clock::now();
+                const Block& blk = blocks[idx];
+                long long first = blk.seq * B;
+                for (int j = 0; j < blk.count; ++j)
+                {
+                    if (progress && (first + j) % 100 == 0)
+                        progress(static_cast<int>(first + j));
+                    emit(blk.paths[j]);
+                }
+                st.busy += Seconds(ts);
+                ++st.blocks;
+                st.waitOut += freeBlocks.Push(idx);
+                ++next;
+            }
+        }
+
+        rngStage.join();
+        for (auto& th : stepStage)
+            th.join();
+        for (const auto& s : stepStats)
+        {
+            stats[1].blocks += s.blocks;
+            stats[1].busy += s.busy;
+            stats[1].waitIn += s.waitIn;
+            stats[1].waitOut += s.waitOut;
+        }
+
+        elapsed = Seconds(t0);
+    }
+
+    const std::vector<PipelineStageStats>& Stages() const { return stats; }
+
+    // Wall time of the last Run() in seconds
+    double ElapsedTime() const { return elapsed; }
+
+    void Print(std::ostream& os = std::cout) const
+    {
+        std::ios::fmtflags flags = os.flags();
+        os << "Pipeline stages (" << config.blockPaths << " paths/block, " << config.queueBlocks << " blocks in flight):\n";
+        os << std::left << std::setw(8) << "stage" << std::right << std::setw(8) << "threads" << std::setw(9) << "blocks"
+            << std::setw(11) << "busy s" << std::setw(11) << "starved s" << std::setw(11) << "blocked s" << std::setw(8) << "util\n";
+        for (const auto& s : stats)
+        {
+            os << std::left << std::setw(8) << s.name << std::right << std::setw(8) << s.threads << std::setw(9) << s.blocks
+                << std::fixed << std::setprecision(4) << std::setw(11) << s.busy << std::setw(11) << s.waitIn
+                << std::setw(11) << s.waitOut << std::setprecision(1) << std::setw(7) << 100.0 * s.Utilization(elapsed) << "%\n";
+            os.flags(flags);
+        }
+        os.flags(flags);
+    }
+
+    void ReportMetrics(RunMetrics& m) const override
+    {
+        m.Set("pipeline.seconds", elapsed);
+        for (const auto& s : stats)
+        {
+            std::string prefix = "pipeline." + s.name;
+            m.Set(prefix + ".threads", s.threads);
+            m.Set(prefix + ".blocks", static_cast<double>(s.blocks));
+            m.Set(prefix + ".busy_seconds", s.busy);
+            m.Set(prefix + ".starved_seconds", s.waitIn);
+            m.Set(prefix + ".blocked_seconds", s.waitOut);
+            m.Set(prefix + ".utilization", s.Utilization(elapsed));
+        }
+    }
+};
+
+#endif
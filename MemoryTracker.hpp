@@ -0,0 +1,278 @@
+/*
+MemoryTracker.hpp
+
+Memory Footprint Instrumentation: Tracked Allocations and Peak RSS
+
+Overview:
+---------
+Path storage, regression matrices and nested simulations can grow memory in
+ways that are hard to predict when sizing jobs on shared hosts. This header
+provides three complementary measurements:
+
+1. Per-component allocation tracking
+   `TrackingAllocator<T, C>` is a standard allocator that books every allocation
+   against a `MemComponent`. Engine containers use it through the
+   `TrackedVector<T, C>` alias; buffers that must stay `std::vector<double>`
+   (e.g. the `Path` handed to pricers) are booked with a `TrackedBytes` guard.
+   For every component the tracker keeps current bytes, peak bytes and the
+   number of allocations.
+
+2. Process peak RSS
+   `PeakRssKb()` reads the kernel high-water mark (VmHWM on Linux, ru_maxrss
+   elsewhere); `ResetPeakRss()` restarts it so a single run can be measured.
+
+3. RSS sampling
+   `RssSampler` polls the resident set on a background thread, for platforms
+   where the high-water mark cannot be reset.
+
+Counters are lock-free atomics, so tracked containers can be used from worker
+threads. `MemoryTracker::ReportMetrics()` publishes everything through the
+`RunMetrics` interface (mem.<component>.current_bytes / peak_bytes / allocations,
+mem.peak_rss_kb).
+
+Usage:
+------
+```cpp
+TrackedVector<double, MemComponent::PathBuffer> state(NSim);
+MemoryTracker::Print(std::cout);
+```
+
+*/
+
+#ifndef MemoryTracker_HPP
+#define MemoryTracker_HPP
+
+#include <atomic>
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <new>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "Metrics.hpp"
+
+enum class MemComponent { RngPool, PathBuffer, PricerState, Other, Count };
+
+class MemoryTracker
+{
+private:
+    struct Counters
+    {
+        std::atomic<long long> current{ 0 };
+        std::atomic<long long> peak{ 0 };
+        std::atomic<long long> allocations{ 0 };
+    };
+
+    static std::array<Counters, static_cast<std::size_t>(MemComponent::Count)>& Table()
+    {
+        static std::array<Counters, static_cast<std::size_t>(MemComponent::Count)> table;
+        return table;
+    }
+
+    static Counters& Of(MemComponent c) { return Table()[static_cast<std::size_t>(c)]; }
+
+public:
+    static const char* Name(MemComponent c)
+    {
+        switch (c)
+        {
+        case MemComponent::RngPool: return "rng_pool";
+        case MemComponent::PathBuffer: return "path_buffer";
+        case MemComponent::PricerState: return "pricer_state";
+        default: return "other";
+        }
+    }
+
+    static void Allocated(MemComponent c, std::size_t bytes)
+    {
+        Counters& k = Of(c);
+        long long now = k.current.fetch_add(static_cast<long long>(bytes)) + static_cast<long long>(bytes);
+        long long old = k.peak.load();
+        while (now > old && !k.peak.compare_exchange_weak(old, now)) {}
+        ++k.allocations;
+    }
+
+    static void Released(MemComponent c, std::size_t bytes)
+    {
+        Of(c).current.fetch_sub(static_cast<long long>(bytes));
+    }
+
+    static long long CurrentBytes(MemComponent c) { return Of(c).current.load(); }
+    static long long PeakBytes(MemComponent c) { return Of(c).peak.load(); }
+    static long long Allocations(MemComponent c) { return Of(c).allocations.load(); }
+
+    // Restart peaks and allocation counts from the current footprint (e.g. per run)
+    static void ResetPeaks()
+    {
+        for (auto& k : Table())
+        {
+            k.peak.store(k.current.load());
+            k.allocations.store(0);
+        }
+    }
+
+    // Process resident-set high-water mark in kB (0 if unavailable)
+    static long PeakRssKb()
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, 6, "VmHWM:") == 0)
+                return std::stol(line.substr(6));
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0)
+#if defined(__APPLE__)
+            return static_cast<long>(ru.ru_maxrss / 1024);
+#else
+            return static_cast<long>(ru.ru_maxrss);
+#endif
+#endif
+        return 0;
+    }
+
+    // Current resident set in kB (0 if unavailable)
+    static long CurrentRssKb()
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, 6, "VmRSS:") == 0)
+                return std::stol(line.substr(6));
+        }
+        return 0;
+    }
+
+    // Reset the high-water mark so the next PeakRssKb() covers only what follows (Linux >= 4.0)
+    static void ResetPeakRss()
+    {
+        std::ofstream clear("/proc/self/clear_refs");
+        if (clear)
+            clear << "5";
+    }
+
+    static void ReportMetrics(RunMetrics& m)
+    {
+        long long total = 0;
+        for (int i = 0; i < static_cast<int>(MemComponent::Count); ++i)
+        {
+            MemComponent c = static_cast<MemComponent>(i);
+            std::string prefix = std::string("mem.") + Name(c);
+            m.Set(prefix + ".current_bytes", static_cast<double>(CurrentBytes(c)));
+            m.Set(prefix + ".peak_bytes", static_cast<double>(PeakBytes(c)));
+            m.Set(prefix + ".allocations", static_cast<double>(Allocations(c)));
+            total += PeakBytes(c);
+        }
+        m.Set("mem.tracked_peak_bytes", static_cast<double>(total));
+        m.Set("mem.peak_rss_kb", static_cast<double>(PeakRssKb()));
+    }
+
+    static void Print(std::ostream& os = std::cout)
+    {
+        std::ios::fmtflags flags = os.flags();
+        os << "Memory (peak): " << std::fixed << std::setprecision(1);
+        for (int i = 0; i < static_cast<int>(MemComponent::Count); ++i)
+        {
+            MemComponent c = static_cast<MemComponent>(i);
+            if (PeakBytes(c) > 0)
+                os << Name(c) << " " << PeakBytes(c) / 1024.0 << " kB (" << Allocations(c) << " allocs), ";
+        }
+        os << "RSS " << PeakRssKb() << " kB\n";
+        os.flags(flags);
+    }
+};
+
+template <typename T, MemComponent C>
+class TrackingAllocator
+{
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = TrackingAllocator<U, C>; };
+
+    TrackingAllocator() noexcept = default;
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, C>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+        MemoryTracker::Allocated(C, n * sizeof(T));
+        return p;
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        MemoryTracker::Released(C, n * sizeof(T));
+        ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U, C>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const TrackingAllocator<U, C>&) const noexcept { return false; }
+};
+
+template <typename T, MemComponent C>
+using TrackedVector = std::vector<T, TrackingAllocator<T, C>>;
+
+class TrackedBytes
+{ // Books a buffer owned elsewhere (e.g. a std::vector<double> Path) for its lifetime
+private:
+    MemComponent component;
+    std::size_t bytes;
+
+public:
+    TrackedBytes(MemComponent c, std::size_t size) : component(c), bytes(size) { MemoryTracker::Allocated(c, size); }
+    ~TrackedBytes() { MemoryTracker::Released(component, bytes); }
+    TrackedBytes(const TrackedBytes&) = delete;
+    TrackedBytes& operator=(const TrackedBytes&) = delete;
+};
+
+class RssSampler
+{ // Polls VmRSS on a background thread and keeps the maximum seen
+private:
+    std::atomic<bool> running;
+    std::atomic<long> peakKb;
+    std::thread worker;
+
+public:
+    explicit RssSampler(int intervalMs = 10) : running(true), peakKb(MemoryTracker::CurrentRssKb())
+    {
+        worker = std::thread([this, intervalMs]() {
+            while (running.load())
+            {
+                long now = MemoryTracker::CurrentRssKb();
+                if (now > peakKb.load())
+                    peakKb.store(now);
+                std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+            }
+        });
+    }
+
+    ~RssSampler() { Stop(); }
+
+    long Stop()
+    {
+        if (running.exchange(false))
+            worker.join();
+        return peakKb.load();
+    }
+
+    long PeakKb() const { return peakKb.load(); }
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+Metrics.hpp
+
+Run Metrics Interface
+
+Overview:
+---------
+A minimal, dependency-free way for engine components to publish numbers about a
+run (timings, path counts, memory usage) under dotted names, e.g.
+
+    engine.seconds, engine.paths, mem.path_buffer.peak_bytes, mem.peak_rss_kb
+
+- RunMetrics: ordered name -> value map with Set/Add/Get and a printer.
+- IMetricsSource: implemented by components that can report into a RunMetrics.
+
+Usage:
+------
+```cpp
+RunMetrics m;
+engine.ReportMetrics(m);
+MemoryTracker::ReportMetrics(m);
+m.Print(std::cout);
+```
+
+*/
+
+#ifndef Metrics_HPP
+#define Metrics_HPP
+
+#include <map>
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+class RunMetrics
+{
+private:
+    std::map<std::string, double> values;
+
+public:
+    void Set(const std::string& name, double value) { values[name] = value; }
+    void Add(const std::string& name, double value) { values[name] += value; }
+
+    double Get(const std::string& name, double fallback = 0.0) const
+    {
+        auto it = values.find(name);
+        return it == values.end() ? fallback : it->second;
+    }
+
+    bool Has(const std::string& name) const { return values.count(name) != 0; }
+
+    const std::map<std::string, double>& Values() const { return values; }
+
+    void Print(std::ostream& os = std::cout) const
+    {
+        for (const auto& kv : values)
+            os << std::left << std::setw(36) << kv.first << std::right << std::setprecision(8) << kv.second << "\n";
+    }
+};
+
+class IMetricsSource
+{
+public:
+    virtual void ReportMetrics(RunMetrics& metrics) const = 0;
+    virtual ~IMetricsSource() = default;
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+NoncentralChiSquare.hpp
+
+Gamma, Poisson, Inverse Gaussian and Noncentral Chi-Square Samplers for Exact Transitions
+
+Overview:
+---------
+Square-root type diffusions (CEV after the change of variable X = S^(2(1-beta)),
+CIR) have transition laws that are Poisson mixtures of gamma distributions. This
+header provides the samplers used by the exact schemes:
+
+- SplitMix64            : small counter-based generator. `FromNormal(z)` seeds it from
+                          the bits of a normal variate, so an FDM scheme can turn the
+                          one normal it receives per step into as many independent
+                          uniforms as it needs while staying stateless (reentrant,
+                          cloneable, reproducible from the path's IRng stream).
+- Gamma(shape)          : Marsaglia-Tsang squeeze; shape < 1 via Gamma(shape + 1) U^(1/shape).
+- Poisson(mean)         : multiplication method below mean 10, Hoermann's PTRS
+                          transformed rejection above.
+- NoncentralChiSquare   : df > 0, 2 Gamma(df/2 + N) with N ~ Poisson(nc/2).
+- AbsorbedBesselSquared : squared Bessel process of dimension delta < 2 absorbed at
+                          zero, at time 1. With G ~ Gamma(1 - delta/2): absorbed if
+                          G >= x/2, else 2 Gamma(N + 1) with N ~ Poisson(x/2 - G).
+                          This is the exact law of the absorbed process (the duality
+                          with dimension 4 - delta), including the atom at zero.
+- InverseGaussian(mean, shape) : Michael-Schucany-Haas transformation; one normal and one
+                          uniform, no rejection (NIG subordinator, LevyModels.hpp).
+
+Block samplers:
+---------------
+The *Block functions process a block of paths one sampling stage at a time
+(all gammas of a constant shape, then all Poisson means, then all Poisson draws,
+...). Shape-dependent constants are computed once per block and the arithmetic
+stages are plain loops the compiler can vectorize; only the accept/reject cores
+remain per element.
+
+*/
+
+#ifndef NoncentralChiSquare_HPP
+#define NoncentralChiSquare_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace Sampling
+{
+    struct SplitMix64
+    {
+        std::uint64_t state;
+
+        explicit SplitMix64(std::uint64_t seed = 0) : state(seed) {}
+
+        std::uint64_t Next()
+        {
+            std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform on the open interval (0, 1)
+        double Uniform()
+        {
+            return (static_cast<double>(Next() >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+        }
+
+        double Normal()
+        {
+            double u1 = Uniform(), u2 = Uniform();
+            return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        }
+    };
+
+    inline SplitMix64 FromNormal(double z, std::uint64_t salt = 0x2545F4914F6CDD1Dull)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &z, sizeof(bits));
+        SplitMix64 g(bits ^ salt);
+        g.Next();
+        return g;
+    }
+
+    struct GammaConstants
+    { // Marsaglia-Tsang constants for one shape
+        double shape, d, c, invShape;
+        bool boost;     // shape < 1: sample shape + 1 and scale by U^(1/shape)
+
+        explicit GammaConstants(double a) : shape(a), boost(a < 1.0)
+        {
+            double s = boost ? a + 1.0 : a;
+            d = s - 1.0 / 3.0;
+            c = 1.0 / std::sqrt(9.0 * d);
+            invShape = 1.0 / a;
+        }
+    };
+
+    inline double Gamma(const GammaConstants& k, SplitMix64& g)
+    {
+        double v;
+        for (;;)
+        {
+            double x = g.Normal();
+            double t = 1.0 + k.c * x;
+            if (t <= 0.0)
+                continue;
+            v = t * t * t;
+            double u = g.Uniform();
+            double x2 = x * x;
+            if (u < 1.0 - 0.0331 * x2 * x2)
+                break;
+            if (std::log(u) < 0.5 * x2 + k.d * (1.0 - v + std::log(v)))
+                break;
+        }
+        double sample = k.d * v;
+        if (k.boost)
+            sample *= std::pow(g.Uniform(), k.invShape);
+        return sample;
+    }
+
+    inline double Gamma(double shape, SplitMix64& g)
+    {
+        return Gamma(GammaConstants(shape), g);
+    }
+
+    inline double Poisson(double mean, SplitMix64& g)
+    {
+        if (mean <= 0.0)
+            return 0.0;
+        if (mean < 10.0)
+        { // Multiply uniforms until the product drops below exp(-mean)
+            double limit = std::exp(-mean), prod = g.Uniform();
+            double k = 0.0;
+            while (prod > limit)
+            {
+                prod *= g.Uniform();
+                k += 1.0;
+            }
+            return k;
+        }
+
+        // PTRS (Hoermann 1993)
+        double slam = std::sqrt(mean), logLam = std::log(mean);
+        double b = 0.931 + 2.53 * slam;
+        double a = -0.059 + 0.02483 * b;
+        double invAlpha = 1.1239 + 1.1328 / (b - 3.4);
+        double vr = 0.9277 - 3.6224 / (b - 2.0);
+        for (;;)
+        {
+            double u = g.Uniform() - 0.5;
+            double v = g.Uniform();
+            double us = 0.5 - std::abs(u);
+            double k = std::floor((2.0 * a / us + b) * u + mean + 0.43);
+            if (us >= 0.07 && v <= vr)
+                return k;
+            if (k < 0.0 || (us < 0.013 && v > us))
+                continue;
+            if (std::log(v) + std::log(invAlpha) - std::log(a / (us * us) + b) <= -mean + k * logLam - std::lgamma(k + 1.0))
+                return k;
+        }
+    }
+
+    inline double NoncentralChiSquare(double df, double nc, SplitMix64& g)
+    { // df > 0
+        double n = Poisson(0.5 * nc, g);
+        return 2.0 * Gamma(0.5 * df + n, g);
+    }
+
+    inline double AbsorbedBesselSquared(double delta, double x, SplitMix64& g)
+    { // delta < 2, started at x, observed at time 1
+        if (x <= 0.0)
+            return 0.0;
+        double gm = Gamma(1.0 - 0.5 * delta, g);
+        double z = 0.5 * x;
+        if (gm >= z)
+            return 0.0;
+        double n = Poisson(z - gm, g);
+        return 2.0 * Gamma(n + 1.0, g);
+    }
+
+    inline double InverseGaussian(double mean, double shape, SplitMix64& g)
+    {
+        double y = g.Normal();
+        y *= y;
+        double my = mean * y;
+        double x = mean + mean * my / (2.0 * shape) - mean / (2.0 * shape) * std::sqrt(4.0 * shape * my + my * my);
+        return (g.Uniform() * (mean + x) <= mean) ? x : mean * mean / x;
+    }
+
+    // Block samplers -------------------------------------------------------
+
+    inline void GammaBlock(double shape, SplitMix64* g, double* out, std::size_t n)
+    {
+        GammaConstants k(shape);
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = Gamma(k, g[i]);
+    }
+
+    inline void InverseGaussianBlock(double mean, double shape, SplitMix64* g, double* out, std::size_t n)
+    { // out[i] ~ IG(mean, shape); the root and the selection are branch-free loops
+        const double c = mean / (2.0 * shape);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            double y = g[i].Normal();
+            out[i] = mean * y * y;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = mean + c * out[i] - c * std::sqrt(4.0 * shape * out[i] + out[i] * out[i]);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            double u = g[i].Uniform();
+            out[i] = (u * (mean + out[i]) <= mean) ? out[i] : mean * mean / out[i];
+        }
+    }
+
+    inline void NoncentralChiSquareBlock(double df, const double* nc, SplitMix64* g, double* out, std::size_t n)
+    { // out[i] ~ chi'^2(df, nc[i]); df > 0
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = Poisson(0.5 * nc[i], g[i]);
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] += 0.5 * df;
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = 2.0 * Gamma(out[i], g[i]);
+    }
+
+    inline void AbsorbedBesselSquaredBlock(double delta, const double* x, SplitMix64* g, double* out, std::size_t n)
+    { // out[i] = absorbed BESQ(delta) at time 1 from x[i]; delta < 2
+        GammaBlock(1.0 - 0.5 * delta, g, out, n);
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = 0.5 * x[i] - out[i];               // Poisson mean, <= 0 when absorbed
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = (out[i] > 0.0) ? Poisson(out[i], g[i]) + 1.0 : 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = (out[i] > 0.0) ? 2.0 * Gamma(out[i], g[i]) : 0.0;
+    }
+}
+
+#endif
@@ -8,6 +8,10 @@
 #define OptionData_HPP
 
 #include <algorithm> // for max()
+#include <functional>
+#include <cmath>
+
+#include "PayoffPolicies.hpp"
 
 #include <boost/parameter.hpp>
 
@@ -78,20 +82,34 @@ struct OptionData
 	}
 
 
+	// Copies K and type: the payoff may outlive this object
 	std::function<double(double)> getPayOff() const
 	{
-		return [this](double S) {
+		return [K = K, type = type](double S) {
 			return (type == 1) ? std::max(S - K, 0.0) : std::max(K - S, 0.0);
 			};
 	}
 
+	// exp(-rT) is computed once, here
 	std::function<double()> getDiscounter() const
 	{
-		return [this]() {
-			return std::exp(-r * T);
+		double df = std::exp(-r * T);
+		return [df]() {
+			return df;
 			};
 	}
 
+	// Compile-time policies for the Basic*Pricer templates (see PayoffPolicies.hpp)
+	VanillaPayoff payoffPolicy() const
+	{
+		return VanillaPayoff(K, type);
+	}
+
+	FlatRateDiscount discountPolicy() const
+	{
+		return FlatRateDiscount(r, T);
+	}
+
 };
 
 
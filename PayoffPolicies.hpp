@@ -0,0 +1,154 @@
+/*
+PayoffPolicies.hpp
+
+Compile-Time Payoff and Discount Policies
+
+Overview:
+---------
+`Payoff` and `Discounter` are std::function objects: every path costs an indirect
+call that cannot be inlined, and lambdas such as `OptionData::getPayOff()` used
+to capture the option by pointer. The policies below are small value types that
+the pricers and batch consumers take as template parameters, so the payoff is
+inlined into the path loop and the discount factor is a stored constant.
+
+Payoff policies (double operator()(double S) const):
+- VanillaPayoff(K, type)        : max(type * (S - K), 0), type 1 == call, -1 == put.
+- DigitalPayoff(K, type, cash)  : cash if type * (S - K) > 0, else 0.
+- CallSpreadPayoff(K1, K2)      : max(S - K1, 0) - max(S - K2, 0), K1 < K2.
+- SpreadPayoff(K, type)         : two assets, max(type * (S1 - S2 - K), 0); K = 0 is the
+                                  exchange option (operator()(double S1, double S2)).
+- CallablePayoff<F>(f)          : any callable; MakePayoff(f) deduces F.
+- FunctionPayoff                : CallablePayoff<Payoff>, the ad-hoc std::function path.
+
+Discount policies (double operator()() const):
+- FlatRateDiscount(r, T)        : exp(-r T), computed once at construction.
+- FixedDiscount(df)             : a given factor; FixedDiscount(discounter) calls the
+                                  std::function once and keeps the value.
+
+Block evaluation:
+-----------------
+EvaluatePayoffs(payoff, S, out, n) and AccumulatePayoffs(payoff, S, n, sum, sum2)
+apply a policy to a contiguous block of terminal values (or averages). With the
+payoff known at compile time these loops are branch-free and vectorizable; they
+are used by the batch consumers in MCBatchEngine.hpp.
+
+Usage:
+------
+```cpp
+BasicEuropeanPricer<VanillaPayoff, FlatRateDiscount> op(VanillaPayoff(K, 1), FlatRateDiscount(r, T));
+auto digital = std::make_shared<BasicEuropeanBatchConsumer<DigitalPayoff, FlatRateDiscount>>(
+    DigitalPayoff(K, 1), FlatRateDiscount(r, T));
+```
+
+*/
+
+#ifndef PayoffPolicies_HPP
+#define PayoffPolicies_HPP
+
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstddef>
+
+struct VanillaPayoff
+{
+    double K;
+    double type;    // 1 == call, -1 == put
+
+    VanillaPayoff(double strike, int optionType) : K(strike), type(optionType == 1 ? 1.0 : -1.0) {}
+
+    double operator()(double S) const { return std::max(type * (S - K), 0.0); }
+};
+
+struct DigitalPayoff
+{ // Cash-or-nothing
+    double K;
+    double type;
+    double cash;
+
+    DigitalPayoff(double strike, int optionType, double cashAmount = 1.0)
+        : K(strike), type(optionType == 1 ? 1.0 : -1.0), cash(cashAmount) {}
+
+    double operator()(double S) const { return type * (S - K) > 0.0 ? cash : 0.0; }
+};
+
+struct CallSpreadPayoff
+{ // Long call at K1, short call at K2
+    double K1;
+    double K2;
+
+    CallSpreadPayoff(double lowerStrike, double upperStrike) : K1(lowerStrike), K2(upperStrike) {}
+
+    double operator()(double S) const { return std::min(std::max(S - K1, 0.0), K2 - K1); }
+};
+
+struct SpreadPayoff
+{ // Option on the spread of two assets
+    double K;
+    double type;
+
+    SpreadPayoff(double strike, int optionType) : K(strike), type(optionType == 1 ? 1.0 : -1.0) {}
+
+    double operator()(double S1, double S2) const { return std::max(type * (S1 - S2 - K), 0.0); }
+};
+
+template <typename F>
+struct CallablePayoff
+{
+    F f;
+
+    explicit CallablePayoff(F callable) : f(std::move(callable)) {}
+
+    double operator()(double S) const { return f(S); }
+};
+
+template <typename F>
+CallablePayoff<F> MakePayoff(F callable)
+{
+    return CallablePayoff<F>(std::move(callable));
+}
+
+using FunctionPayoff = CallablePayoff<std::function<double(double)>>;
+
+struct FlatRateDiscount
+{
+    double df;
+
+    FlatRateDiscount(double r, double T) : df(std::exp(-r * T)) {}
+
+    double operator()() const { return df; }
+};
+
+struct FixedDiscount
+{
+    double df;
+
+    explicit FixedDiscount(double discountFactor) : df(discountFactor) {}
+    explicit FixedDiscount(const std::function<double()>& discounter) : df(discounter()) {}
+
+    double operator()() const { return df; }
+};
+
+template <typename P>
+inline void EvaluatePayoffs(const P& payoff, const double* S, double* out, std::size_t n)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = payoff(S[i]);
+}
+
+template <typename P>
+inline void AccumulatePayoffs(const P& payoff, const double* S, std::size_t n, double& sum, double& sum2)
+{
+    double s = 0.0, s2 = 0.0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        double v = payoff(S[i]);
+        s += v;
+        s2 += v * v;
+    }
+    sum += s;
+    sum2 += s2;
+}
+
+#endif
@@ -0,0 +1,274 @@
+/*
+PortfolioPricer.hpp
+
+Netted Portfolio Pricing with Euler Risk Allocation
+
+Overview:
+---------
+If only the value and risk of a hedged book matter, pricing each position with
+its own consumer repeats the payoff work per position. The separate standard
+errors also ignore the netting: a call hedged with a forward has a far smaller
+spread per path than the call alone, but the sum of the standalone errors does
+not show it.
+
+`PortfolioBatchConsumer` receives the terminal values of one underlying from
+MCBatchEngine and evaluates the netted payoff of all positions
+    P_i = sum_j q_j X_j(S_i)
+in one pass over the tile. The portfolio price and standard error come from the
+per-path P_i, so offsetting positions cancel path by path.
+
+Vectorization:
+--------------
+The tile is cut into chunks of Chunk = 64 paths in local arrays (the tail is
+padded and masked with zero weights). For each position the payoff kind is
+switched once per chunk, and the inner loop runs over the chunk with a
+compile-time trip count, so it vectorizes. The values go to one row per
+position, so the moments need no second evaluation. Sums use four partial
+lanes. Custom payoffs (a std::function) are called per path and do not
+vectorize. With 8 vanillas the consumer costs about half of 8 separate
+BasicEuropeanBatchConsumer<VanillaPayoff, ...>; see portfolio_netted_8.
+
+Euler allocation:
+-----------------
+The risk measure is the standard deviation of the discounted per-path payoff,
+sigma_P. It is homogeneous of degree one in the quantities, so Euler's theorem
+splits it into contributions that add up exactly:
+    c_j = q_j dsigma_P/dq_j = Cov(q_j X_j, P) / sigma_P,     sum_j c_j = sigma_P
+The same split divided by sqrt(N) allocates the portfolio standard error. Each
+position also gets its value (the value is linear, so these add up to the price)
+and its standalone standard error. StandaloneStdErr() sums those; that is the
+error bound that separate pricing would give.
+
+Usage:
+------
+```cpp
+std::vector<PortfolioPosition> book{
+    { "call 65", PositionType::Call, 65.0, 1.0 },
+    { "delta hedge", PositionType::Forward, 65.0, -0.45 }
+};
+auto portfolio = std::make_shared<PortfolioBatchConsumer>(book, discounter);
+MCBatchEngine engine(parts, { portfolio }, NSim, BatchMode::CacheBlocked);
+engine.start();
+std::cout << portfolio->Price() << " +- " << portfolio->StdErr() << std::endl;
+for (const auto& c : portfolio->Contributions())
+    std::cout << c.name << " " << c.price << " " << c.riskContribution << std::endl;
+```
+
+*/
+
+#ifndef PortfolioPricer_HPP
+#define PortfolioPricer_HPP
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+#include "Pricers.hpp"
+#include "MCBatchEngine.hpp"
+#include "Metrics.hpp"
+#include "MemoryTracker.hpp"
+
+enum class PositionType { Call, Put, DigitalCall, DigitalPut, Forward, Custom };
+
+struct PortfolioPosition
+{
+    std::string name;
+    PositionType type;
+    double strike = 0.0;
+    double quantity = 1.0;          // Signed; short positions are negative
+    Payoff payoff = nullptr;        // PositionType::Custom only
+};
+
+struct PositionContribution
+{ // Discounted, per position
+    std::string name;
+    double price;                   // Value in the book (quantity included)
+    double stdErr;                  // Standalone standard error
+    double riskContribution;        // Euler share of the per-path standard deviation
+    double stdErrContribution;      // Euler share of the portfolio standard error
+};
+
+template <typename DiscountPolicy>
+class BasicPortfolioBatchConsumer : public IBatchConsumer, public IMetricsSource
+{
+private:
+    static constexpr std::size_t Chunk = 64;
+
+    std::vector<PortfolioPosition> positions;
+    DiscountPolicy m_discounter;
+    int NT = 0;
+
+    // Undiscounted running sums: the netted payoff and, per position, the value, its
+    // square and its product with the netted payoff
+    double sum = 0.0, sum2 = 0.0;
+    std::vector<double> sumX, sumX2, sumXP;
+    long long NSim = 0;
+
+    // Payoffs of the current chunk, one row of Chunk values per position
+    TrackedVector<double, MemComponent::PricerState> values;
+
+    double price = 0.0, stdErr = 0.0, sigma = 0.0;
+    std::vector<PositionContribution> contributions;
+
+    static double Sum(const double* a)
+    {
+        double s[4] = {};
+        for (std::size_t i = 0; i < Chunk; i += 4)
+            for (int l = 0; l < 4; ++l)
+                s[l] += a[i + l];
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+
+    static double Dot(const double* a, const double* b)
+    {
+        double s[4] = {};
+        for (std::size_t i = 0; i < Chunk; i += 4)
+            for (int l = 0; l < 4; ++l)
+                s[l] += a[i + l] * b[i + l];
+        return (s[0] + s[1]) + (s[2] + s[3]);
+    }
+
+    // v = q * X(S) * w over one chunk. The loops write a local array that is copied out
+    // (v could alias S or w, and the vectorizer will not version the loop for that), and
+    // the kinks are selects: a std::max returning a reference does not vectorize either.
+    static void Evaluate(const PortfolioPosition& p, const double* S, const double* w, double* v)
+    {
+        double K = p.strike, q = p.quantity;
+        double out[Chunk];
+        switch (p.type)
+        {
+        case PositionType::Call:
+            for (std::size_t i = 0; i < Chunk; ++i) { double d = S[i] - K; out[i] = q * (d > 0.0 ? d : 0.0) * w[i]; }
+            break;
+        case PositionType::Put:
+            for (std::size_t i = 0; i < Chunk; ++i) { double d = K - S[i]; out[i] = q * (d > 0.0 ? d : 0.0) * w[i]; }
+            break;
+        case PositionType::DigitalCall:
+            for (std::size_t i = 0; i < Chunk; ++i) out[i] = (S[i] > K ? q : 0.0) * w[i];
+            break;
+        case PositionType::DigitalPut:
+            for (std::size_t i = 0; i < Chunk; ++i) out[i] = (S[i] <= K ? q : 0.0) * w[i];
+            break;
+        case PositionType::Forward:
+            for (std::size_t i = 0; i < Chunk; ++i) out[i] = q * (S[i] - K) * w[i];
+            break;
+        case PositionType::Custom:
+            for (std::size_t i = 0; i < Chunk; ++i) out[i] = w[i] != 0.0 ? q * p.payoff(S[i]) : 0.0;
+            break;
+        }
+        std::copy(out, out + Chunk, v);
+    }
+
+    void AccumulateChunk(const double* x, std::size_t m)
+    {
+        double S[Chunk], w[Chunk], P[Chunk];
+        for (std::size_t i = 0; i < m; ++i) S[i] = x[i];
+        for (std::size_t i = m; i < Chunk; ++i) S[i] = x[m - 1];
+        for (std::size_t i = 0; i < Chunk; ++i) w[i] = i < m ? 1.0 : 0.0;
+
+        // Pass 1: every position into its row of `values`, summed into the netted payoff
+        std::fill(P, P + Chunk, 0.0);
+        for (std::size_t j = 0; j < positions.size(); ++j)
+        {
+            double* v = values.data() + j * Chunk;
+            Evaluate(positions[j], S, w, v);
+            for (std::size_t i = 0; i < Chunk; ++i) P[i] += v[i];
+        }
+        sum += Sum(P);
+        sum2 += Dot(P, P);
+
+        // Pass 2: per-position moments against the netted payoff
+        for (std::size_t j = 0; j < positions.size(); ++j)
+        {
+            const double* v = values.data() + j * Chunk;
+            sumX[j] += Sum(v);
+            sumX2[j] += Dot(v, v);
+            sumXP[j] += Dot(v, P);
+        }
+    }
+
+public:
+    BasicPortfolioBatchConsumer(std::vector<PortfolioPosition> book, DiscountPolicy discounter)
+        : positions(std::move(book)), m_discounter(std::move(discounter))
+    {
+        if (positions.empty())
+            throw std::invalid_argument("PortfolioBatchConsumer: the book has no positions");
+        for (const auto& p : positions)
+            if (p.type == PositionType::Custom && !p.payoff)
+                throw std::invalid_argument("PortfolioBatchConsumer: custom position '" + p.name + "' has no payoff");
+        sumX.assign(positions.size(), 0.0);
+        sumX2.assign(positions.size(), 0.0);
+        sumXP.assign(positions.size(), 0.0);
+        values.assign(positions.size() * Chunk, 0.0);
+    }
+
+    void Begin(std::size_t, int numSteps) override { NT = numSteps; }
+
+    void Update(const double* x, std::size_t n, int step) override
+    {
+        if (step != NT)
+            return;
+        for (std::size_t first = 0; first < n; first += Chunk)
+            AccumulateChunk(x + first, std::min(Chunk, n - first));
+        NSim += static_cast<long long>(n);
+    }
+
+    void EndTile(std::size_t) override {}
+
+    void End() override
+    {
+        double df = m_discounter();
+        double N = static_cast<double>(NSim);
+        double mean = sum / N;
+        price = df * mean;
+        sigma = df * std::sqrt(std::max(sum2 / N - mean * mean, 0.0));
+        stdErr = (NSim > 1) ? sigma / std::sqrt(N - 1.0) : 0.0;
+
+        contributions.clear();
+        for (std::size_t j = 0; j < positions.size(); ++j)
+        {
+            double mX = sumX[j] / N;
+            double varX = std::max(sumX2[j] / N - mX * mX, 0.0);
+            double cov = sumXP[j] / N - mX * mean;
+            double risk = sigma > 0.0 ? df * df * cov / sigma : 0.0;
+            double se = (NSim > 1) ? df * std::sqrt(varX / (N - 1.0)) : 0.0;
+            double seShare = (NSim > 1) ? risk / std::sqrt(N - 1.0) : 0.0;
+            contributions.push_back({ positions[j].name, df * mX, se, risk, seShare });
+        }
+    }
+
+    double Price() const { return price; }
+    double StdErr() const { return stdErr; }
+    long long Paths() const { return NSim; }
+
+    // Standard deviation of the discounted netted payoff per path
+    double RiskStdDev() const { return sigma; }
+
+    // Sum of the standalone standard errors, i.e. what pricing each position alone reports
+    double StandaloneStdErr() const
+    {
+        double s = 0.0;
+        for (const auto& c : contributions)
+            s += c.stdErr;
+        return s;
+    }
+
+    const std::vector<PortfolioPosition>& Positions() const { return positions; }
+    const std::vector<PositionContribution>& Contributions() const { return contributions; }
+
+    void ReportMetrics(RunMetrics& m) const override
+    {
+        m.Set("portfolio.positions", static_cast<double>(positions.size()));
+        m.Set("portfolio.price", price);
+        m.Set("portfolio.stderr", stdErr);
+        m.Set("portfolio.standalone_stderr", StandaloneStdErr());
+        m.Set("portfolio.risk_stddev", sigma);
+    }
+};
+
+using PortfolioBatchConsumer = BasicPortfolioBatchConsumer<Discounter>;
+
+#endif
@@ -17,21 +17,56 @@ Core Concepts:
   a payoff function and discount factor to compute expected discounted payoff.
 - All pricers follow the `IPricer` interface, which mandates processing paths,
   post-processing results, and providing final price output.
+- `CloneEmpty(stream)` returns a fresh pricer for the same contract with no paths
+  accumulated, and `Merge(other)` adds another pricer's accumulators (sums, path
+  counts, crossing counters). Parallel engines give every thread a clone, merge
+  the clones into the original and call `PostProcess()` once, without knowing
+  the concrete pricer type.
+
+Seasoned contracts:
+-------------------
+A position that is partly elapsed is simulated from the valuation date only: the
+SDE starts at today's spot and runs over the remaining life. What is already known
+goes into a `SeasonedState` passed to the Asian and barrier pricers:
+- fixingSum / fixingCount: the past fixings of an average, including one on the
+  valuation date if there is one. A seasoned path then contributes its grid points
+  after t = 0 only (t = 0 is in the past), so the average is
+  (fixingSum + sum_{i >= 1} S_i) / (fixingCount + NT). With fixingCount == 0 the
+  contract is at inception and all NT + 1 points are averaged, as before.
+- runningMax / runningMin: the extremes of the past path; a past maximum at or
+  above an up-and-out barrier knocks the contract out.
+- knockedOut: the barrier was already hit; every path pays the rebate. For the
+  continuously monitored BrownianBridgePricer this must reflect the whole past
+  path, not only the recorded fixings: a crossing between the last fixing and
+  today is otherwise missed. If only discrete observations are known, set
+  lastFixing / sinceLastFixing and the pricer adds the bridge crossing
+  probability of that gap, exp(-2 (L - S_last)(L - S_0) / (b(S_last)^2 gap)).
+`Observe(fixing)` adds one past fixing to the sum, count and extremes. The time
+grid of the remaining period should fall on the remaining fixing dates.
 
 Class Hierarchy:
 ----------------
 - IPricer: Interface defining standard operations for any pricer.
-- Pricer: Abstract base class holding a payoff function and discounter.
+- BasicPricer<PayoffPolicy, DiscountPolicy>: Abstract base class holding a payoff and
+  a discounter. `Pricer` is BasicPricer<Payoff, Discounter> (std::function types).
 - EuropeanPricer: Prices plain vanilla options by evaluating the terminal value.
 - AsianPricer: Prices Asian options based on average value across the path.
 - BarrierPricer: Implements simple knock-out barrier option logic.
 - BrownianBridgePricer: Improves barrier detection using Brownian bridge approximation
   between discrete time steps (for high accuracy).
 
+Each concrete pricer is a template Basic<Name>Pricer<PayoffPolicy, DiscountPolicy>;
+the familiar names are aliases for the std::function instantiation, e.g.
+EuropeanPricer = BasicEuropeanPricer<Payoff, Discounter>. Instantiating with the
+policies of PayoffPolicies.hpp (VanillaPayoff, DigitalPayoff, CallSpreadPayoff,
+CallablePayoff, FlatRateDiscount, FixedDiscount) dispatches the payoff at compile
+time and reads a precomputed discount factor.
+
 Design Features:
 ----------------
 - Extensible structure: new exotic options can be implemented by inheriting from `Pricer`.
-- All pricers work with user-supplied `Payoff` and `Discounter` lambdas/functions.
+- All pricers work with user-supplied `Payoff` and `Discounter` lambdas/functions,
+  or with compile-time payoff/discount policies.
 - BrownianBridgePricer demonstrates a more refined barrier crossing check using
   path-dependent probability calculations.
 
@@ -57,41 +92,98 @@ then pass simulated paths via `ProcessPath()`, call `PostProcess()`, and query t
 #include <random>
 #include <numeric>
 #include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <typeinfo>
+#include <limits>
 
 
 #include "SDE.hpp"
+#include "PayoffPolicies.hpp"
 
 using Path = std::vector<double>;
 using Payoff = std::function<double(double)>;
 using Discounter = std::function<double()>;
 
+struct SeasonedState
+{ // What is known at the valuation date (t = 0 of the simulation) about a contract that started earlier
+    double fixingSum = 0.0;
+    int fixingCount = 0;
+    double runningMax = -std::numeric_limits<double>::infinity();
+    double runningMin = std::numeric_limits<double>::infinity();
+    bool knockedOut = false;
+
+    // Continuously monitored barriers: the last value observed before today and the time
+    // since it (years). BrownianBridgePricer bridges that unobserved gap to today's spot.
+    // Leave sinceLastFixing at 0 when knockedOut already covers the path up to today.
+    double lastFixing = 0.0;
+    double sinceLastFixing = 0.0;
+
+    void Observe(double fixing)
+    {
+        fixingSum += fixing;
+        ++fixingCount;
+        runningMax = std::max(runningMax, fixing);
+        runningMin = std::min(runningMin, fixing);
+    }
+
+    bool Seasoned() const { return fixingCount > 0; }
+
+    // Up-and-out: hit before the valuation date
+    bool KnockedOutAbove(double barrier) const { return knockedOut || runningMax >= barrier; }
+};
+
 class IPricer {
 public:
     virtual void ProcessPath(const Path& path) = 0;
     virtual void PostProcess() = 0;
     virtual double DiscountFactor() const = 0;
     virtual double Price() const = 0;
+
+    // Same contract, no accumulated paths. `stream` tells clones apart (e.g. the
+    // worker id) for pricers that draw their own random numbers. Both are needed only by
+    // the cloning mode of MCParallelEngine; pricers that do not override them throw.
+    virtual std::shared_ptr<IPricer> CloneEmpty(unsigned) const { throw std::logic_error("IPricer: not cloneable"); }
+    // Adds the paths accumulated by `other`, which must be of the same type
+    virtual void Merge(const IPricer&) { throw std::logic_error("IPricer: not cloneable"); }
+
     virtual ~IPricer() = default;
 };
 
-class Pricer : public IPricer {
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicPricer : public IPricer {
 protected:
-    Payoff m_payoff;
-    Discounter m_discounter;
+    PayoffPolicy m_payoff;
+    DiscountPolicy m_discounter;
 public:
-    Pricer(Payoff payoff, Discounter discounter)
+    BasicPricer(PayoffPolicy payoff, DiscountPolicy discounter)
         : m_payoff(std::move(payoff)), m_discounter(std::move(discounter)) {
     }
+
+    template <typename T>
+    static const T& SameType(const IPricer& other) {
+        const T* p = dynamic_cast<const T*>(&other);
+        if (p == nullptr)
+            throw std::invalid_argument(std::string("Merge: expected ") + typeid(T).name() + ", got " + typeid(other).name());
+        return *p;
+    }
 };
 
-class EuropeanPricer : public Pricer {
+using Pricer = BasicPricer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicEuropeanPricer : public BasicPricer<PayoffPolicy, DiscountPolicy> {
 private:
+    using Base = BasicPricer<PayoffPolicy, DiscountPolicy>;
+    using Base::m_payoff;
+    using Base::m_discounter;
+
     double sum;
     int NSim;
     double price;
 
 public:
-    EuropeanPricer(Payoff payoff, Discounter discounter): Pricer(std::move(payoff), std::move(discounter)), price(0.0), sum(0.0), NSim(0) 
+    BasicEuropeanPricer(PayoffPolicy payoff, DiscountPolicy discounter): Base(std::move(payoff), std::move(discounter)), price(0.0), sum(0.0), NSim(0) 
     {
     }
     void ProcessPath(const Path& path) override {
@@ -112,14 +204,32 @@ public:
     double Price() const override {
         return price;
     }
+
+    std::shared_ptr<IPricer> CloneEmpty(unsigned) const override {
+        return std::make_shared<BasicEuropeanPricer>(m_payoff, m_discounter);
+    }
+
+    void Merge(const IPricer& other) override {
+        const auto& o = Base::template SameType<BasicEuropeanPricer>(other);
+        sum += o.sum;
+        NSim += o.NSim;
+    }
 };
 
-class AsianPricer : public Pricer {
+using EuropeanPricer = BasicEuropeanPricer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicAsianPricer : public BasicPricer<PayoffPolicy, DiscountPolicy> {
 private:
+    using Base = BasicPricer<PayoffPolicy, DiscountPolicy>;
+    using Base::m_payoff;
+    using Base::m_discounter;
+
     double sum;
     int NSim;
     double price;
     double avg = 0.0;
+    SeasonedState past;
 
     static double Average(const Path& path) {
         double avg = 0.0;
@@ -143,12 +253,15 @@ private:
     }
 
 public:
-    AsianPricer(Payoff payoff, Discounter discounter): Pricer(std::move(payoff), std::move(discounter)), sum(0.0), NSim(0), price(0.0)
+    BasicAsianPricer(PayoffPolicy payoff, DiscountPolicy discounter, SeasonedState seasoned = SeasonedState())
+        : Base(std::move(payoff), std::move(discounter)), sum(0.0), NSim(0), price(0.0), past(seasoned)
     {
     }
 
     void ProcessPath(const Path& path) override {
-        double avg = Average(path);
+        double avg = past.Seasoned()
+            ? (past.fixingSum + std::accumulate(path.begin() + 1, path.end(), 0.0)) / (past.fixingCount + path.size() - 1.0)
+            : Average(path);
         sum += m_payoff(avg);
         ++NSim;
     }
@@ -165,27 +278,45 @@ public:
     double Price() const override {
         return price;
     }
+
+    std::shared_ptr<IPricer> CloneEmpty(unsigned) const override {
+        return std::make_shared<BasicAsianPricer>(m_payoff, m_discounter, past);
+    }
+
+    void Merge(const IPricer& other) override {
+        const auto& o = Base::template SameType<BasicAsianPricer>(other);
+        sum += o.sum;
+        NSim += o.NSim;
+    }
 };
 
-class BarrierPricer : public Pricer
+using AsianPricer = BasicAsianPricer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicBarrierPricer : public BasicPricer<PayoffPolicy, DiscountPolicy>
 {
 private:
+    using Base = BasicPricer<PayoffPolicy, DiscountPolicy>;
+    using Base::m_payoff;
+    using Base::m_discounter;
+
     double price;
     double sum, sum2;
     int NSim;
+    SeasonedState past;
 public:
-    BarrierPricer(Payoff payoff, Discounter discounter) : Pricer(std::move(payoff), std::move(discounter)), price(0.0), sum(0.0), sum2(0.0), NSim(0)
+    BasicBarrierPricer(PayoffPolicy payoff, DiscountPolicy discounter, SeasonedState seasoned = SeasonedState())
+        : Base(std::move(payoff), std::move(discounter)), price(0.0), sum(0.0), sum2(0.0), NSim(0), past(seasoned)
     {
     }
     void ProcessPath(const Path& path) override {
         double L = 170.0;
         double rebate = 0.0;
 
-        bool knockedOut = false;
-        for (const auto& price : path) {
-            if (price >= L) {  // Down-and-Out barrier triggered
+        bool knockedOut = past.KnockedOutAbove(L);
+        for (std::size_t n = 0; n < path.size() && !knockedOut; ++n) {
+            if (path[n] >= L) {  // Down-and-Out barrier triggered
                 knockedOut = true;
-                break;
             }
         }
 
@@ -212,28 +343,69 @@ public:
     double Price() const override {
         return price;
 	}
+
+    std::shared_ptr<IPricer> CloneEmpty(unsigned) const override {
+        return std::make_shared<BasicBarrierPricer>(m_payoff, m_discounter, past);
+    }
+
+    void Merge(const IPricer& other) override {
+        const auto& o = Base::template SameType<BasicBarrierPricer>(other);
+        sum += o.sum;
+        sum2 += o.sum2;
+        NSim += o.NSim;
+    }
 };
 
-class BrownianBridgePricer : public Pricer {
+using BarrierPricer = BasicBarrierPricer<Payoff, Discounter>;
+
+template <typename PayoffPolicy, typename DiscountPolicy>
+class BasicBrownianBridgePricer : public BasicPricer<PayoffPolicy, DiscountPolicy> {
 private:
+    using Base = BasicPricer<PayoffPolicy, DiscountPolicy>;
+    using Base::m_payoff;
+    using Base::m_discounter;
+
     double price;
     double sum, sum2;
     int NSim;
     double dt;
     std::shared_ptr<GBM> sde;
     int counter = 0;
+    unsigned seed;
     std::mt19937 rng;
     std::uniform_real_distribution<double> dist;
+    SeasonedState past;
 public:
 
-    BrownianBridgePricer(Payoff payoff,
-        Discounter discounter,
+    BasicBrownianBridgePricer(PayoffPolicy payoff,
+        DiscountPolicy discounter,
         std::shared_ptr<GBM> isde,
         double step)
-        : Pricer(std::move(payoff), std::move(discounter)),
+        : Base(std::move(payoff), std::move(discounter)),
         price(0.0), sum(0.0), sum2(0.0), NSim(0), dt(step),
         sde(std::move(isde)),
-        rng(std::random_device{}()), dist(0.0, 1.0){
+        seed(std::random_device{}()), rng(seed), dist(0.0, 1.0){
+    }
+
+    BasicBrownianBridgePricer(PayoffPolicy payoff,
+        DiscountPolicy discounter,
+        std::shared_ptr<GBM> isde,
+        double step,
+        unsigned seed,
+        SeasonedState seasoned)
+        : BasicBrownianBridgePricer(std::move(payoff), std::move(discounter), std::move(isde), step, seed) {
+        past = seasoned;
+    }
+
+    BasicBrownianBridgePricer(PayoffPolicy payoff,
+        DiscountPolicy discounter,
+        std::shared_ptr<GBM> isde,
+        double step,
+        unsigned seed)
+        : Base(std::move(payoff), std::move(discounter)),
+        price(0.0), sum(0.0), sum2(0.0), NSim(0), dt(step),
+        sde(std::move(isde)),
+        seed(seed), rng(seed), dist(0.0, 1.0){
     }
 
     void ProcessPath(const Path& path) override 
@@ -242,9 +414,15 @@ public:
         double rebate = 0.0;
         double P, tmp, u;
 
-        bool crossed = false;
+        bool crossed = past.KnockedOutAbove(L);
+        if (!crossed && past.sinceLastFixing > 0.0)
+        { // The unobserved gap between the last fixing and today's spot
+            tmp = sde->Diffusion(past.lastFixing, 0.0);
+            P = std::exp(-2.0 * (L - past.lastFixing) * (L - path[0]) / (tmp * tmp * past.sinceLastFixing));
+            crossed = P >= dist(rng);
+        }
 
-        for (size_t n = 1; n < path.size(); ++n) {
+        for (size_t n = 1; n < path.size() && !crossed; ++n) {
             tmp = sde->Diffusion(static_cast<double>(path[n - 1]), static_cast<double>((n - 1) * dt));
             P = std::exp(-2.0 * (L - path[n - 1]) * (L - path[n]) / (tmp * tmp * dt));
             u = dist(rng);
@@ -279,8 +457,29 @@ public:
     {
         return price;
     }
-    
+
+    // Number of bridge crossings detected between grid points
+    int Crossings() const
+    {
+        return counter;
+    }
+
+    std::shared_ptr<IPricer> CloneEmpty(unsigned stream) const override
+    { // Independent uniform stream per clone
+        return std::make_shared<BasicBrownianBridgePricer>(m_payoff, m_discounter, sde, dt, seed + 0x9E3779B9u * (stream + 1u), past);
+    }
+
+    void Merge(const IPricer& other) override
+    {
+        const auto& o = Base::template SameType<BasicBrownianBridgePricer>(other);
+        sum += o.sum;
+        sum2 += o.sum2;
+        NSim += o.NSim;
+        counter += o.counter;
+    }
 
 };
 
+using BrownianBridgePricer = BasicBrownianBridgePricer<Payoff, Discounter>;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,197 @@
+/*
+RingBuffer.hpp
+
+Bounded Lock-Free Ring Buffers for Stage-to-Stage Hand-Off
+
+Overview:
+---------
+Fixed-capacity queues used to connect the stages of the pipelined Monte Carlo
+engine (see MCPipeline.hpp). Both are lock-free, allocate only at construction
+and round the capacity up to a power of two.
+
+- SpscRing<T> : single producer / single consumer (Lamport queue). One atomic
+                store per operation; head and tail live on separate cache lines.
+- MpmcRing<T> : multiple producers / multiple consumers (Vyukov's bounded
+                queue). Every cell carries a sequence number, so producers and
+                consumers only contend on their own index.
+
+TryPush/TryPop never block: a full ring rejects the push and an empty ring
+rejects the pop. Push/Pop spin briefly and then yield until they succeed, which
+is the back-pressure between stages: a fast producer stalls on a full ring
+instead of allocating more work. They return the seconds spent waiting, so
+stages can report how long they were starved or blocked.
+
+Usage:
+------
+```cpp
+SpscRing<int> ring(8);
+ring.Push(42);
+int v;
+ring.Pop(v);
+```
+
+*/
+
+#ifndef RingBuffer_HPP
+#define RingBuffer_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+
+namespace RingDetail
+{
+    constexpr std::size_t CacheLine = 64;
+
+    inline std::size_t RoundUpPow2(std::size_t n)
+    {
+        std::size_t c = 1;
+        while (c < n)
+            c <<= 1;
+        return c;
+    }
+
+    // Retries op() until it succeeds; returns the time spent waiting in seconds
+    template <typename Op>
+    double Wait(Op op)
+    {
+        if (op())
+            return 0.0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int spin = 0; !op(); ++spin)
+        {
+            if (spin >= 64)
+                std::this_thread::yield();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    }
+}
+
+template <typename T>
+class SpscRing
+{
+private:
+    std::vector<T> buffer;
+    std::size_t mask;
+    alignas(RingDetail::CacheLine) std::atomic<std::size_t> head; // next slot to read (consumer)
+    alignas(RingDetail::CacheLine) std::atomic<std::size_t> tail; // next slot to write (producer)
+
+public:
+    explicit SpscRing(std::size_t capacity)
+        : buffer(RingDetail::RoundUpPow2(capacity < 2 ? 2 : capacity)), mask(buffer.size() - 1), head(0), tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    std::size_t Capacity() const { return buffer.size(); }
+
+    bool TryPush(const T& value)
+    {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == buffer.size())
+            return false;
+        buffer[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value)
+    {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        value = buffer[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    double Push(const T& value) { return RingDetail::Wait([&]() { return TryPush(value); }); }
+    double Pop(T& value) { return RingDetail::Wait([&]() { return TryPop(value); }); }
+};
+
+template <typename T>
+class MpmcRing
+{
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(RingDetail::CacheLine) std::atomic<std::size_t> enqueuePos;
+    alignas(RingDetail::CacheLine) std::atomic<std::size_t> dequeuePos;
+
+public:
+    explicit MpmcRing(std::size_t capacity) : enqueuePos(0), dequeuePos(0)
+    {
+        std::size_t n = RingDetail::RoundUpPow2(capacity < 2 ? 2 : capacity);
+        cells.reset(new Cell[n]);
+        mask = n - 1;
+        for (std::size_t i = 0; i < n; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpmcRing(const MpmcRing&) = delete;
+    MpmcRing& operator=(const MpmcRing&) = delete;
+
+    std::size_t Capacity() const { return mask + 1; }
+
+    bool TryPush(const T& value)
+    {
+        std::size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;)
+        {
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; // Full
+            else
+                pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value)
+    {
+        std::size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;)
+        {
+            cell = &cells[pos & mask];
+            std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; // Empty
+            else
+                pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+        value = cell->data;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    double Push(const T& value) { return RingDetail::Wait([&]() { return TryPush(value); }); }
+    double Pop(T& value) { return RingDetail::Wait([&]() { return TryPop(value); }); }
+};
+
+#endif
@@ -35,6 +35,12 @@ Dependencies:
 -------------
 - <random>, <functional>, <cmath>, <chrono>, <vector>
 
+Seeding:
+--------
+- Default constructors seed from `std::random_device` (non-reproducible runs).
+- The `explicit (unsigned seed)` constructors give reproducible streams, e.g. one
+  independent generator per worker or per underlying in batch jobs.
+
 Usage:
 ------
 Create an instance of the desired RNG (e.g., `BoxMullerNet`) and call `GenerateRn()`
@@ -73,6 +79,9 @@ public:
     PolarMarsagliaNet(): rng(std::random_device{}()), dist(0.0, 1.0) 
     {
     }
+    explicit PolarMarsagliaNet(unsigned seed): rng(seed), dist(0.0, 1.0)
+    {
+    }
 
     double GenerateRn() override
     {
@@ -97,6 +106,8 @@ private:
 public:
     MyMersenneTwister() : rng(std::random_device{}()), dist(0.0, 1.0)
     { }
+    explicit MyMersenneTwister(unsigned seed) : rng(seed), dist(0.0, 1.0)
+    { }
     double GenerateRn() override
     {
         return dist(rng);
@@ -113,6 +124,9 @@ public:
     BoxMullerNet(): rng(std::random_device{}()), dist(0.0, 1.0), U1(0.0), U2(0.0)
     {
     }
+    explicit BoxMullerNet(unsigned seed): rng(seed), dist(0.0, 1.0), U1(0.0), U2(0.0)
+    {
+    }
     double GenerateRn() override
     {
         do
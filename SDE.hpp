@@ -7,8 +7,9 @@ This C++ implementation is modified and ported from the original C# source file
 Overview:
 ---------
 This header defines an interface (`ISde`) and concrete stochastic processes
-(Geometric Brownian Motion and Constant Elasticity of Variance) used for simulating
-underlying asset dynamics in financial models.
+(Geometric Brownian Motion, Constant Elasticity of Variance and the CIR square-root
+process) used for simulating underlying asset dynamics, short rates, intensities
+and variances in financial models.
 
 
 Class Hierarchy:
@@ -16,29 +17,64 @@ Class Hierarchy:
 - ISde: Interface for general SDEs with drift, diffusion, and derivative functions,
         as well as configuration of initial condition and expiry time.
 - GBM: Implements Geometric Brownian Motion, widely used in Black-Scholes models.
+- TermStructureGbm: GBM with a deterministic, piecewise-linear short-rate curve r(t).
 - CEV: Implements the Constant Elasticity of Variance process, capturing volatility
        skew via an exponent parameter .
 
+- CIR: Implements the Cox-Ingersoll-Ross square-root process.
+- SeasonedSde: Any model restarted mid-life, for contracts that are partly elapsed.
+
 Design Features:
 ----------------
 - `Drift(x, t)` and `Diffusion(x, t)` define the SDE's core behavior.
 - `DriftCorrected(x, t, B)` supports corrected drift used in Milstein-like methods.
 - `DiffusionDerivative(x, t)` is required for higher-order solvers (e.g., Milstein, Platen).
 - `InitialCondition()` and `Expiry()` manage simulation setup parameters.
+- `Clone()` returns an independent copy for thread-local use.
+- `LinearDrift(t, a0, a1)` reports a drift of the form a0(t) + a1(t) x, which lets
+  implicit schemes solve their step in closed form (false when not linear).
 
 GBM Model:
 ----------
 $$ dS_t = (\mu - q) S_t dt + \sigma S_t dW_t $$
 Simple lognormal model with constant volatility.
 
+TermStructureGbm Model:
+-----------------------
+$$ dS_t = (r(t) - q) S_t dt + \sigma S_t dW_t $$
+r(t) interpolates linearly between (time, rate) knots and is flat outside them.
+The drift is linear with a time-dependent slope, so LinearDrift() reports it and
+GeneralizedFittedPredictorCorrectorFdm integrates it exactly over each step.
+AverageRate(T) is the rate that discounts to T.
+
 CEV Model:
 ----------
 $$ dS_t = (\mu - q) S_t dt + \sigma S_t^\beta dW_t $$
 Where  controls the elasticity of variance. Supports volatility smiles/skews.
+The diffusion is set to 0 for S <= 0 so that std::pow never sees a negative base
+(NaN). This is not absorption: an explicit Euler or Milstein step can overshoot
+below zero, and the (r - q) S drift then keeps the state negative. Only
+ExactCevFdm.hpp, which samples the exact transition for beta < 1, absorbs paths
+at zero.
+
+CIR Model:
+----------
+$$ dr_t = \kappa (\theta - r_t) dt + \sigma \sqrt{r_t} dW_t $$
+Mean-reverting and non-negative; zero is attainable unless 2 kappa theta >= sigma^2
+(Feller). The diffusion uses max(r, 0), so explicit schemes do not produce NaN;
+CirFdm.hpp has the exact, QE and full-truncation Euler schemes.
+
+Seasoned contracts:
+-------------------
+A contract that started `elapsed` years ago only needs its remaining life
+simulated. `SeasonedSde(model, elapsed, spot)` starts at today's spot with expiry
+T - elapsed and evaluates the model's coefficients at t + elapsed, so
+time-dependent models keep their calendar. The past of the path (fixings, extremes,
+knock-outs) goes into the pricers' SeasonedState (Pricers.hpp).
 
 Dependencies:
 -------------
-- <cmath>, <memory>
+- <cmath>, <memory>, <vector>, <algorithm>
 
 Usage:
 ------
@@ -52,6 +88,9 @@ and use its methods in FDM solvers or Monte Carlo engines.
 #define SDE_HPP
 #include <cmath>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 class ISde {
 protected:
@@ -71,6 +110,13 @@ public:
     virtual double Expiry() const = 0;
     virtual void Expiry(double val) = 0;
 
+    // Independent copy with the same parameters (e.g. one per worker thread). Only the
+    // cloning mode of MCParallelEngine needs it; models that do not override it throw.
+    virtual std::shared_ptr<ISde> Clone() const { throw std::logic_error("ISde: not cloneable"); }
+
+    // Drift(x, t) == a0 + a1 * x? Models with a linear drift override this.
+    virtual bool LinearDrift(double t, double& a0, double& a1) const { return false; }
+
     virtual ~ISde() = default;
 };
 
@@ -110,6 +156,90 @@ public:
 
     double Expiry() const { return exp; }
     void Expiry(double val) { exp = val; }
+    std::shared_ptr<ISde> Clone() const override {
+        return std::make_shared<GBM>(*this);
+    }
+    bool LinearDrift(double t, double& a0, double& a1) const override {
+        a0 = 0.0;
+        a1 = mu - div;
+        return true;
+    }
+};
+
+class TermStructureGbm : public ISde {
+private:
+    std::vector<double> times, rates;   // Knots of r(t), times increasing
+    double div;
+    double vol;
+
+public:
+    TermStructureGbm(std::vector<double> knotTimes, std::vector<double> knotRates, double dividendYield,
+        double diffusionCoefficient, double initialCondition, double expiry)
+        : times(std::move(knotTimes)), rates(std::move(knotRates)), div(dividendYield), vol(diffusionCoefficient)
+    {
+        if (times.empty() || times.size() != rates.size() || !std::is_sorted(times.begin(), times.end())
+            || std::adjacent_find(times.begin(), times.end()) != times.end())
+            throw std::invalid_argument("TermStructureGbm: needs one rate per knot and increasing knot times");
+        InitialCondition(initialCondition);
+        Expiry(expiry);
+    }
+
+    double Rate(double t) const {
+        if (t <= times.front())
+            return rates.front();
+        if (t >= times.back())
+            return rates.back();
+        std::size_t j = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+        double w = (t - times[j - 1]) / (times[j] - times[j - 1]);
+        return rates[j - 1] + w * (rates[j] - rates[j - 1]);
+    }
+
+    // (1/T) int_0^T r(t) dt, exact for the piecewise-linear curve
+    double AverageRate(double T) const {
+        if (T <= 0.0)
+            return Rate(0.0);
+        double integral = 0.0, t0 = 0.0;
+        for (std::size_t j = 0; j <= times.size() && t0 < T; ++j)
+        {
+            double t1 = (j < times.size()) ? std::min(times[j], T) : T;
+            if (t1 > t0)
+            {
+                integral += 0.5 * (Rate(t0) + Rate(t1)) * (t1 - t0);
+                t0 = t1;
+            }
+        }
+        return integral / T;
+    }
+
+    double Drift(double x, double t) const override {
+        return (Rate(t) - div) * x;
+    }
+
+    double Diffusion(double x, double t) const override {
+        return vol * x;
+    }
+
+    double DriftCorrected(double x, double t, double B) const override {
+        return Drift(x, t) - B * Diffusion(x, t) * DiffusionDerivative(x, t);
+    }
+
+    double DiffusionDerivative(double x, double t) const override {
+        return vol;
+    }
+
+    double InitialCondition() const { return ic; }
+    void InitialCondition(double val) { ic = val; }
+
+    double Expiry() const { return exp; }
+    void Expiry(double val) { exp = val; }
+    std::shared_ptr<ISde> Clone() const override {
+        return std::make_shared<TermStructureGbm>(*this);
+    }
+    bool LinearDrift(double t, double& a0, double& a1) const override {
+        a0 = 0.0;
+        a1 = Rate(t) - div;
+        return true;
+    }
 };
 
 class CEV : public ISde {
@@ -134,6 +264,8 @@ public:
     }
 
     double Diffusion(double x, double t) const override {
+        if (x <= 0.0)
+            return 0.0; // Avoids std::pow of a negative base (NaN); not an absorbing boundary
         return vol * std::pow(x, b);
     }
 
@@ -142,6 +274,8 @@ public:
     }
 
     double DiffusionDerivative(double x, double t) const override {
+        if (x <= 0.0)
+            return 0.0;
         if (b > 1.0)
             return vol * b * std::pow(x, b - 1.0);
         else
@@ -153,7 +287,120 @@ public:
 
     double Expiry() const { return exp; }
     void Expiry(double val) { exp = val; }
+    std::shared_ptr<ISde> Clone() const override {
+        return std::make_shared<CEV>(*this);
+    }
+    bool LinearDrift(double t, double& a0, double& a1) const override {
+        a0 = 0.0;
+        a1 = mu - d;
+        return true;
+    }
+
+    // Parameters of dS = m S dt + s S^beta dW, for exact samplers
+    double Beta() const { return b; }
+    double LocalVolCoefficient() const { return vol; }   // s = sigma * S0^(1 - beta)
+    double NetDrift() const { return mu - d; }           // m
 };
 
 
+class CIR : public ISde {
+private:
+    double kappa;
+    double theta;
+    double sigma;
+
+public:
+    CIR(double meanReversion, double longRunMean, double volatility,
+        double initialCondition, double expiry)
+        : kappa(meanReversion), theta(longRunMean), sigma(volatility)
+    {
+        InitialCondition(initialCondition);
+        Expiry(expiry);
+    }
+
+    double Drift(double x, double t) const override {
+        return kappa * (theta - x);
+    }
+
+    double Diffusion(double x, double t) const override {
+        return (x > 0.0) ? sigma * std::sqrt(x) : 0.0;
+    }
+
+    double DriftCorrected(double x, double t, double B) const override {
+        return Drift(x, t) - B * Diffusion(x, t) * DiffusionDerivative(x, t);
+    }
+
+    double DiffusionDerivative(double x, double t) const override {
+        return (x > 0.0) ? 0.5 * sigma / std::sqrt(x) : 0.0;
+    }
+
+    double InitialCondition() const { return ic; }
+    void InitialCondition(double val) { ic = val; }
+
+    double Expiry() const { return exp; }
+    void Expiry(double val) { exp = val; }
+    std::shared_ptr<ISde> Clone() const override {
+        return std::make_shared<CIR>(*this);
+    }
+    bool LinearDrift(double t, double& a0, double& a1) const override {
+        a0 = kappa * theta;
+        a1 = -kappa;
+        return true;
+    }
+
+    double Kappa() const { return kappa; }
+    double Theta() const { return theta; }
+    double Sigma() const { return sigma; }
+    bool FellerSatisfied() const { return 2.0 * kappa * theta >= sigma * sigma; }
+};
+
+class SeasonedSde : public ISde {
+private:
+    std::shared_ptr<ISde> model;   // As specified at inception
+    double elapsed;
+
+public:
+    SeasonedSde(std::shared_ptr<ISde> inceptionModel, double elapsedTime, double spot)
+        : model(std::move(inceptionModel)), elapsed(elapsedTime)
+    {
+        if (!model || !(elapsed >= 0.0) || !(elapsed < model->Expiry()))
+            throw std::invalid_argument("SeasonedSde: needs a model and 0 <= elapsed < expiry");
+        InitialCondition(spot);
+        Expiry(model->Expiry() - elapsed);
+    }
+
+    double Drift(double x, double t) const override {
+        return model->Drift(x, t + elapsed);
+    }
+
+    double Diffusion(double x, double t) const override {
+        return model->Diffusion(x, t + elapsed);
+    }
+
+    double DriftCorrected(double x, double t, double B) const override {
+        return model->DriftCorrected(x, t + elapsed, B);
+    }
+
+    double DiffusionDerivative(double x, double t) const override {
+        return model->DiffusionDerivative(x, t + elapsed);
+    }
+
+    double InitialCondition() const { return ic; }
+    void InitialCondition(double val) { ic = val; }
+
+    double Expiry() const { return exp; }
+    void Expiry(double val) { exp = val; }
+    std::shared_ptr<ISde> Clone() const override {
+        auto copy = std::make_shared<SeasonedSde>(model->Clone(), elapsed, ic);
+        copy->Expiry(exp);
+        return copy;
+    }
+    bool LinearDrift(double t, double& a0, double& a1) const override {
+        return model->LinearDrift(t + elapsed, a0, a1);
+    }
+
+    double Elapsed() const { return elapsed; }
+    std::shared_ptr<ISde> Model() const { return model; }
+};
+
 #endif
\ No newline at end of file
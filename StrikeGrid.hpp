@@ -0,0 +1,140 @@
+/*
+StrikeGrid.hpp
+
+Vectorized Evaluation of Vanilla Payoffs over a Whole Strike Grid
+
+Overview:
+---------
+Pricing M strikes from the same N simulated terminal values with a loop of
+`EuropeanPricer`s costs O(N * M) payoff evaluations. `StrikeGridEvaluator`
+sorts the terminal values once and builds suffix sums of S, S^2 and the pathwise
+tangents dS/dS0 and dS/dsigma. Every strike is then a binary search plus a few
+arithmetic operations:
+
+    sum_i max(S_i - K, 0)   = sum_{S_i > K} S_i - K * #{S_i > K}
+    sum_i max(S_i - K, 0)^2 = sum_{S_i > K} S_i^2 - 2K sum_{S_i > K} S_i + K^2 #{S_i > K}
+
+so the whole grid costs O(N log N + M log N), with the heavy part being contiguous
+passes over the sorted arrays. Puts follow from the complementary (S_i <= K) sums.
+
+Pathwise Greeks:
+----------------
+The pathwise estimators of delta and vega for a call are
+    delta = df * E[ 1{S_T > K} dS_T/dS0 ],   vega = df * E[ 1{S_T > K} dS_T/dsigma ]
+and the put versions use -1{S_T <= K}. The caller supplies the per-path tangents
+(may be null, in which case the corresponding Greek is reported as zero).
+
+Usage:
+------
+```cpp
+StrikeGridEvaluator grid({ 90.0, 100.0, 110.0 });
+std::vector<StrikeQuote> quotes;
+grid.Evaluate(ST.data(), dST_dS0.data(), dST_dSig.data(), ST.size(), std::exp(-r * T), quotes);
+```
+
+*/
+
+#ifndef StrikeGrid_HPP
+#define StrikeGrid_HPP
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+#include "MemoryTracker.hpp"
+
+struct StrikeQuote
+{ // Discounted Monte Carlo results for one strike and option type
+
+    double K;
+    int type;         // 1 == call, -1 == put
+    double price;
+    double stdErr;
+    double delta;
+    double vega;
+};
+
+class StrikeGridEvaluator
+{
+private:
+    std::vector<double> strikes;
+
+    // Work arrays, reused between calls (sorted values and suffix sums)
+    TrackedVector<std::size_t, MemComponent::PricerState> order;
+    TrackedVector<double, MemComponent::PricerState> sortedS;
+    TrackedVector<double, MemComponent::PricerState> sufS, sufS2, sufD, sufV;
+
+public:
+    explicit StrikeGridEvaluator(std::vector<double> strikeGrid) : strikes(std::move(strikeGrid))
+    {
+        std::sort(strikes.begin(), strikes.end());
+    }
+
+    const std::vector<double>& Strikes() const { return strikes; }
+
+    // Evaluate calls and puts at every strike. `out` receives 2 * #strikes quotes,
+    // ordered (K0 call, K0 put, K1 call, K1 put, ...).
+    void Evaluate(const double* S, const double* dS0, const double* dSig, std::size_t n,
+        double discountFactor, std::vector<StrikeQuote>& out)
+    {
+        out.clear();
+        if (n == 0)
+            return;
+
+        order.resize(n);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::sort(order.begin(), order.end(), [S](std::size_t a, std::size_t b) { return S[a] < S[b]; });
+
+        sortedS.resize(n);
+        sufS.assign(n + 1, 0.0);
+        sufS2.assign(n + 1, 0.0);
+        sufD.assign(n + 1, 0.0);
+        sufV.assign(n + 1, 0.0);
+
+        for (std::size_t i = 0; i < n; ++i)
+            sortedS[i] = S[order[i]];
+
+        // Suffix sums: suf[j] = sum over sorted positions j..n-1
+        for (std::size_t j = n; j-- > 0;)
+        {
+            double s = sortedS[j];
+            sufS[j] = sufS[j + 1] + s;
+            sufS2[j] = sufS2[j + 1] + s * s;
+            sufD[j] = sufD[j + 1] + (dS0 ? dS0[order[j]] : 0.0);
+            sufV[j] = sufV[j + 1] + (dSig ? dSig[order[j]] : 0.0);
+        }
+
+        double N = static_cast<double>(n);
+        double totS = sufS[0], totS2 = sufS2[0], totD = sufD[0], totV = sufV[0];
+
+        auto stdErr = [N, discountFactor](double sum, double sum2) {
+            if (N < 2.0) return 0.0;
+            double mean = sum / N;
+            double var = std::max(sum2 / N - mean * mean, 0.0) * N / (N - 1.0);
+            return discountFactor * std::sqrt(var / N);
+        };
+
+        out.reserve(2 * strikes.size());
+        for (double K : strikes)
+        {
+            std::size_t j = static_cast<std::size_t>(std::upper_bound(sortedS.begin(), sortedS.end(), K) - sortedS.begin());
+            double cntAbove = N - static_cast<double>(j);
+            double sA = sufS[j], s2A = sufS2[j];
+            double sB = totS - sA, s2B = totS2 - s2A;
+            double cntBelow = static_cast<double>(j);
+
+            double callSum = sA - K * cntAbove;
+            double callSum2 = s2A - 2.0 * K * sA + K * K * cntAbove;
+            double putSum = K * cntBelow - sB;
+            double putSum2 = K * K * cntBelow - 2.0 * K * sB + s2B;
+
+            out.push_back({ K, 1, discountFactor * callSum / N, stdErr(callSum, callSum2),
+                discountFactor * sufD[j] / N, discountFactor * sufV[j] / N });
+            out.push_back({ K, -1, discountFactor * putSum / N, stdErr(putSum, putSum2),
+                -discountFactor * (totD - sufD[j]) / N, -discountFactor * (totV - sufV[j]) / N });
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,337 @@
+/*
+SurfacePipeline.hpp
+
+End-of-Day Option Surface Generation (Prices, Greeks and Implied Vols)
+
+Overview:
+---------
+For every underlying the pipeline produces a strike x expiry surface in one pass:
+
+1. Simulate   - NSim paths are simulated ONCE on the union time grid of all
+                expiries. Values are recorded at each expiry node, together with
+                pathwise tangents dS/dS0 and dS/dsigma obtained from two shadow
+                paths driven by the same normals (common random numbers).
+2. Evaluate   - `StrikeGridEvaluator` prices every strike at every expiry (calls
+                and puts) from the recorded values, with pathwise delta and vega.
+3. Invert     - The out-of-the-money quote at each node is inverted to a
+                Black-Scholes implied volatility.
+4. Write      - Results are written as CSV and/or a compact binary file.
+
+Underlyings are independent and are processed in parallel by a small pool of
+worker threads. Every underlying gets its own RNG, seeded deterministically
+from `SurfaceConfig::seed` and its position in the input list, so a run is
+reproducible regardless of the number of threads.
+
+Time grid:
+----------
+The union grid is uniform: NT = ceil(maxExpiry * stepsPerYear) steps of size
+k = maxExpiry / NT, and each expiry is mapped to its nearest node. The expiry
+actually simulated (node * k) is what is reported and used for the implied vol.
+
+Stage timings:
+--------------
+`SurfaceResult::timings` holds wall-clock seconds spent in each stage for that
+underlying; `SurfacePipeline::Run()` also reports the end-to-end wall time.
+
+Usage:
+------
+```cpp
+UnderlyingSpec spx{ "SPX", 100.0, 0.03, 0.01, 0.2, { 0.25, 0.5, 1.0 }, { 80, 90, 100, 110, 120 } };
+SurfaceConfig cfg; cfg.NSim = 100000;
+SurfacePipeline pipeline(cfg);
+auto results = pipeline.Run({ spx });
+SurfacePipeline::WriteCsv("surface.csv", results);
+```
+
+*/
+
+#ifndef SurfacePipeline_HPP
+#define SurfacePipeline_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <limits>
+#include <algorithm>
+
+#include "SDE.hpp"
+#include "Fdm.hpp"
+#include "Rng.hpp"
+#include "StrikeGrid.hpp"
+#include "Analytics.hpp"
+#include "MemoryTracker.hpp"
+
+struct UnderlyingSpec
+{
+    std::string name;
+    double S0;
+    double r;
+    double q;
+    double sig;
+    std::vector<double> expiries;
+    std::vector<double> strikes;
+};
+
+// Builds the scheme for one (S0, vol) pair on a grid of NT steps up to `horizon`.
+using SurfaceModelFactory = std::function<std::shared_ptr<FdmBase>(const UnderlyingSpec& spec,
+    double S0, double vol, double horizon, int NT)>;
+using SurfaceRngFactory = std::function<std::shared_ptr<IRng>(unsigned seed)>;
+
+struct SurfaceConfig
+{
+    int NSim = 50000;
+    double stepsPerYear = 252.0;
+    double relativeBump = 1.0e-4;     // Shadow-path bump for the pathwise tangents
+    unsigned seed = 12345;
+    int threads = 0;                  // 0 == std::thread::hardware_concurrency()
+
+    SurfaceModelFactory model = [](const UnderlyingSpec& spec, double S0, double vol, double horizon, int NT) {
+        auto sde = std::make_shared<GBM>(spec.r, vol, spec.q, S0, horizon);
+        return std::shared_ptr<FdmBase>(std::make_shared<MilsteinFdm>(sde, NT));
+    };
+
+    SurfaceRngFactory rng = [](unsigned seed) {
+        return std::shared_ptr<IRng>(std::make_shared<BoxMullerNet>(seed));
+    };
+};
+
+struct SurfacePoint
+{
+    double T;           // Simulated expiry (grid node)
+    StrikeQuote quote;
+    double impliedVol;  // NaN when the quote cannot be inverted
+};
+
+struct StageTimings
+{
+    double simulate = 0.0;
+    double evaluate = 0.0;
+    double invert = 0.0;
+    double write = 0.0;
+};
+
+struct SurfaceResult
+{
+    std::string name;
+    std::vector<SurfacePoint> points;
+    StageTimings timings;
+};
+
+class SurfacePipeline
+{
+private:
+    SurfaceConfig cfg;
+    double lastWallTime = 0.0;
+
+    static double Seconds(std::chrono::steady_clock::time_point from)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - from).count();
+    }
+
+    SurfaceResult Process(const UnderlyingSpec& spec, unsigned seed) const
+    {
+        SurfaceResult result;
+        result.name = spec.name;
+        if (spec.expiries.empty() || spec.strikes.empty())
+            return result;
+
+        // Union grid
+        double horizon = *std::max_element(spec.expiries.begin(), spec.expiries.end());
+        int NT = std::max(1, static_cast<int>(std::ceil(horizon * cfg.stepsPerYear - 1.0e-9)));
+
+        auto fdm = cfg.model(spec, spec.S0, spec.sig, horizon, NT);
+        double hS = cfg.relativeBump * spec.S0;
+        double hV = cfg.relativeBump * spec.sig;
+        auto fdmDelta = cfg.model(spec, spec.S0 + hS, spec.sig, horizon, NT);
+        auto fdmVega = cfg.model(spec, spec.S0, spec.sig + hV, horizon, NT);
+        auto rng = cfg.rng(seed);
+
+        double k = fdm->k;
+        std::vector<int> nodes;
+        for (double T : spec.expiries)
+            nodes.push_back(std::min(NT, std::max(1, static_cast<int>(std::lround(T / k)))));
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+        // Stage 1: simulate once, record value and tangents at each expiry node
+        auto t0 = std::chrono::steady_clock::now();
+        std::size_t nExp = nodes.size();
+        std::size_t NSim = static_cast<std::size_t>(cfg.NSim);
+        TrackedVector<double, MemComponent::PathBuffer> values(nExp * NSim), dS0(nExp * NSim), dSig(nExp * NSim);
+
+        for (std::size_t i = 0; i < NSim; ++i)
+        {
+            double x = spec.S0, xd = spec.S0 + hS, xv = spec.S0;
+            int n = 0;
+            for (std::size_t e = 0; e < nExp; ++e)
+            {
+                for (; n < nodes[e]; ++n)
+                {
+                    double z = rng->GenerateRn();
+                    double tn = fdm->x[n];
+                    x = fdm->advance(x, tn, k, z);
+                    xd = fdmDelta->advance(xd, tn, k, z);
+                    xv = fdmVega->advance(xv, tn, k, z);
+                }
+                values[e * NSim + i] = x;
+                dS0[e * NSim + i] = (xd - x) / hS;
+                dSig[e * NSim + i] = (xv - x) / hV;
+            }
+        }
+        result.timings.simulate = Seconds(t0);
+
+        // Stage 2: all strikes at every expiry
+        t0 = std::chrono::steady_clock::now();
+        StrikeGridEvaluator grid(spec.strikes);
+        std::vector<StrikeQuote> quotes;
+        result.points.reserve(nExp * 2 * spec.strikes.size());
+        for (std::size_t e = 0; e < nExp; ++e)
+        {
+            double T = nodes[e] * k;
+            grid.Evaluate(&values[e * NSim], &dS0[e * NSim], &dSig[e * NSim], NSim, std::exp(-spec.r * T), quotes);
+            for (const auto& qt : quotes)
+                result.points.push_back({ T, qt, std::numeric_limits<double>::quiet_NaN() });
+        }
+        result.timings.evaluate = Seconds(t0);
+
+        // Stage 3: implied vols from the out-of-the-money side of each node
+        t0 = std::chrono::steady_clock::now();
+        for (auto& p : result.points)
+        {
+            double fwd = spec.S0 * std::exp((spec.r - spec.q) * p.T);
+            bool otm = (p.quote.type == 1) ? (p.quote.K >= fwd) : (p.quote.K < fwd);
+            if (otm)
+                p.impliedVol = Analytics::ImpliedVolatility(p.quote.price, spec.S0, p.quote.K, p.T,
+                    spec.r, spec.q, p.quote.type);
+        }
+        result.timings.invert = Seconds(t0);
+
+        return result;
+    }
+
+    template <typename T>
+    static void Put(std::vector<char>& buf, T value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        buf.insert(buf.end(), bytes, bytes + sizeof(T));
+    }
+
+public:
+    explicit SurfacePipeline(SurfaceConfig config = SurfaceConfig()) : cfg(std::move(config)) {}
+
+    std::vector<SurfaceResult> Run(const std::vector<UnderlyingSpec>& underlyings)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<SurfaceResult> results(underlyings.size());
+
+        int nThreads = cfg.threads > 0 ? cfg.threads : static_cast<int>(std::thread::hardware_concurrency());
+        nThreads = std::max(1, std::min(nThreads, static_cast<int>(underlyings.size())));
+
+        std::atomic<std::size_t> next(0);
+        auto worker = [&]() {
+            for (std::size_t i = next++; i < underlyings.size(); i = next++)
+                results[i] = Process(underlyings[i], cfg.seed + static_cast<unsigned>(i));
+        };
+
+        std::vector<std::thread> pool;
+        for (int t = 1; t < nThreads; ++t)
+            pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool)
+            th.join();
+
+        lastWallTime = Seconds(start);
+        return results;
+    }
+
+    // End-to-end wall time of the last Run() (excludes writing)
+    double WallTime() const { return lastWallTime; }
+
+    static void WriteCsv(const std::string& fileName, std::vector<SurfaceResult>& results)
+    {
+        std::ofstream out(fileName);
+        if (!out)
+            throw std::runtime_error("SurfacePipeline: cannot open " + fileName);
+
+        out << "underlying,expiry,strike,type,price,stderr,delta,vega,impliedVol\n";
+        out << std::setprecision(10);
+        for (auto& res : results)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            for (const auto& p : res.points)
+            {
+                out << res.name << ',' << p.T << ',' << p.quote.K << ',' << (p.quote.type == 1 ? 'C' : 'P') << ','
+                    << p.quote.price << ',' << p.quote.stdErr << ',' << p.quote.delta << ',' << p.quote.vega << ',';
+                if (!std::isnan(p.impliedVol))
+                    out << p.impliedVol;
+                out << '\n';
+            }
+            res.timings.write += Seconds(t0);
+        }
+    }
+
+    // Binary layout (little-endian host order):
+    //   "MCSF" | uint32 version | uint32 #underlyings
+    //   per underlying: uint32 nameLength | name | uint32 #points
+    //   per point: float T, float K, int8 type, double price, float stderr, float delta, float vega, float iv
+    static void WriteBinary(const std::string& fileName, std::vector<SurfaceResult>& results)
+    {
+        std::ofstream out(fileName, std::ios::binary);
+        if (!out)
+            throw std::runtime_error("SurfacePipeline: cannot open " + fileName);
+
+        std::vector<char> buf = { 'M', 'C', 'S', 'F' };
+        Put<std::uint32_t>(buf, 1);
+        Put<std::uint32_t>(buf, static_cast<std::uint32_t>(results.size()));
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+
+        for (auto& res : results)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            buf.clear();
+            Put<std::uint32_t>(buf, static_cast<std::uint32_t>(res.name.size()));
+            buf.insert(buf.end(), res.name.begin(), res.name.end());
+            Put<std::uint32_t>(buf, static_cast<std::uint32_t>(res.points.size()));
+            for (const auto& p : res.points)
+            {
+                Put<float>(buf, static_cast<float>(p.T));
+                Put<float>(buf, static_cast<float>(p.quote.K));
+                Put<std::int8_t>(buf, static_cast<std::int8_t>(p.quote.type));
+                Put<double>(buf, p.quote.price);
+                Put<float>(buf, static_cast<float>(p.quote.stdErr));
+                Put<float>(buf, static_cast<float>(p.quote.delta));
+                Put<float>(buf, static_cast<float>(p.quote.vega));
+                Put<float>(buf, static_cast<float>(p.impliedVol));
+            }
+            out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+            res.timings.write += Seconds(t0);
+        }
+    }
+
+    static void PrintTimings(const std::vector<SurfaceResult>& results, double wallTime, std::ostream& os = std::cout)
+    {
+        os << "\n=== Surface Stage Timings (s) ===\n";
+        os << std::left << std::setw(12) << "Underlying" << std::setw(12) << "Simulate" << std::setw(12) << "Evaluate"
+            << std::setw(12) << "Invert" << std::setw(12) << "Write" << "\n";
+        for (const auto& res : results)
+        {
+            os << std::setw(12) << res.name << std::setw(12) << res.timings.simulate << std::setw(12) << res.timings.evaluate
+                << std::setw(12) << res.timings.invert << std::setw(12) << res.timings.write << "\n";
+        }
+        os << "End-to-end (parallel) wall time: " << wallTime << "s\n";
+    }
+};
+
+#endif
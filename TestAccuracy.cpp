@@ -0,0 +1,17 @@
+#include "AccuracySuite.hpp"
+#include <iostream>
+#include <string>
+
+// Usage: TestAccuracy [fast|nightly]
+// Returns a non-zero exit code when any case fails, so it can gate merges.
+int main(int argc, char* argv[])
+{
+	AccuracyTier tier = AccuracyTier::Fast;
+	if (argc > 1 && std::string(argv[1]) == "nightly")
+		tier = AccuracyTier::Nightly;
+
+	AccuracySuite suite;
+	int failures = suite.Run(tier, std::cout);
+
+	return failures == 0 ? 0 : 1;
+}
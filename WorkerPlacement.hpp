@@ -0,0 +1,272 @@
+/*
+WorkerPlacement.hpp
+
+Thread Affinity and NUMA-Aware Placement for Simulation Workers
+
+Overview:
+---------
+On multi-socket hosts, OS thread migration and cross-socket memory traffic make
+parallel Monte Carlo throughput erratic. `WorkerPlacement` maps engine workers
+onto the machine topology:
+
+- CpuTopology   : NUMA nodes and their CPUs, read from sysfs
+                  (/sys/devices/system/node/node<n>/cpulist). Nodes are indexed
+                  by position; KernelId() keeps the <n> of each, since node ids
+                  can have gaps. Without sysfs the machine is treated as a
+                  single node with std::thread::hardware_concurrency() CPUs.
+- Policy        : None (OS scheduling), Compact (fill node 0 before node 1) or
+                  Scatter (round-robin over nodes). A node limit restricts a run
+                  to the first n nodes, e.g. to compare 1 vs 2 sockets.
+- Apply(worker) : called on the worker's own thread. Pins the thread to its CPU
+                  (pthread_setaffinity_np on Linux) and, when built with
+                  MC_HAVE_LIBNUMA, binds it to the node (by kernel id) with local
+                  allocation.
+- Partition     : splits NSim by node first (proportional to the workers on each
+                  node) and then evenly within a node, so every node's paths are a
+                  contiguous range.
+
+NUMA-local memory:
+------------------
+`MCParallelEngine` builds each worker's parts (SDE/FDM/RNG), path buffer and pricer
+on the worker thread after Apply(). With Linux's default first-touch policy the
+pages therefore land on the worker's node even without libnuma; MC_HAVE_LIBNUMA
+(link with -lnuma) makes the binding explicit. On other platforms placement
+degrades to a no-op and the engine behaves as before.
+
+Usage:
+------
+```cpp
+WorkerPlacement placement(WorkerPlacement::Policy::Compact);
+MCParallelEngine engine(factory, NSim, placement.Workers(), placement);
+engine.start();
+```
+
+*/
+
+#ifndef WorkerPlacement_HPP
+#define WorkerPlacement_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#endif
+
+#if defined(MC_HAVE_LIBNUMA)
+#include <numa.h>
+#endif
+
+class CpuTopology
+{
+private:
+    std::vector<std::vector<int>> nodes; // CPUs per NUMA node
+    std::vector<int> kernelIds;          // node<id> in sysfs; ids can have gaps (offline or CPU-less nodes)
+
+    static std::vector<int> ParseCpuList(const std::string& list)
+    { // "0-3,8-11" -> { 0, 1, 2, 3, 8, 9, 10, 11 }
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ','))
+        {
+            if (range.empty() || range == "\n")
+                continue;
+            std::size_t dash = range.find('-');
+            int lo = std::stoi(range.substr(0, dash));
+            int hi = (dash == std::string::npos) ? lo : std::stoi(range.substr(dash + 1));
+            for (int c = lo; c <= hi; ++c)
+                cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+public:
+    CpuTopology()
+    {
+#if defined(__linux__)
+        std::vector<int> ids;
+        if (DIR* dir = opendir("/sys/devices/system/node"))
+        {
+            while (dirent* e = readdir(dir))
+            {
+                std::string name = e->d_name;
+                if (name.compare(0, 4, "node") == 0 && name.size() > 4 && std::isdigit(static_cast<unsigned char>(name[4])))
+                    ids.push_back(std::stoi(name.substr(4)));
+            }
+            closedir(dir);
+        }
+        std::sort(ids.begin(), ids.end());
+        for (int id : ids)
+        {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            if (std::getline(in, list))
+            {
+                auto cpus = ParseCpuList(list);
+                if (!cpus.empty())
+                {
+                    nodes.push_back(cpus);
+                    kernelIds.push_back(id);
+                }
+            }
+        }
+#endif
+        if (nodes.empty())
+        { // Single node fallback
+            int n = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            nodes.emplace_back();
+            for (int c = 0; c < n; ++c)
+                nodes.back().push_back(c);
+            kernelIds.assign(1, 0);
+        }
+    }
+
+    int Nodes() const { return static_cast<int>(nodes.size()); }
+    const std::vector<int>& Cpus(int node) const { return nodes[node]; }
+    // Kernel node id (as libnuma expects it) of the node at position `node`
+    int KernelId(int node) const { return kernelIds[node]; }
+
+    int TotalCpus() const
+    {
+        int n = 0;
+        for (const auto& cpus : nodes)
+            n += static_cast<int>(cpus.size());
+        return n;
+    }
+};
+
+class WorkerPlacement
+{
+public:
+    enum class Policy { None, Compact, Scatter };
+
+private:
+    struct Slot { int node; int nodeId; int cpu; }; // node: position in the topology, nodeId: kernel id
+
+    Policy policy;
+    CpuTopology topology;
+    std::vector<Slot> slots; // one per worker
+
+public:
+    // workers == 0: one worker per CPU of the selected nodes; maxNodes == 0: all nodes
+    explicit WorkerPlacement(Policy placementPolicy = Policy::Compact, int workers = 0, int maxNodes = 0)
+        : policy(placementPolicy)
+    {
+        int nNodes = topology.Nodes();
+        if (maxNodes > 0)
+            nNodes = std::min(nNodes, maxNodes);
+
+        int capacity = 0;
+        for (int n = 0; n < nNodes; ++n)
+            capacity += static_cast<int>(topology.Cpus(n).size());
+        if (workers <= 0)
+            workers = capacity;
+
+        // Order the CPUs of the selected nodes according to the policy
+        std::vector<Slot> order;
+        if (policy == Policy::Scatter)
+        {
+            for (std::size_t i = 0; static_cast<int>(order.size()) < capacity; ++i)
+                for (int n = 0; n < nNodes; ++n)
+                    if (i < topology.Cpus(n).size())
+                        order.push_back({ n, topology.KernelId(n), topology.Cpus(n)[i] });
+        }
+        else
+        {
+            for (int n = 0; n < nNodes; ++n)
+                for (int cpu : topology.Cpus(n))
+                    order.push_back({ n, topology.KernelId(n), cpu });
+        }
+
+        // More workers than CPUs: wrap around (oversubscription)
+        for (int w = 0; w < workers; ++w)
+            slots.push_back(order[w % order.size()]);
+    }
+
+    Policy PlacementPolicy() const { return policy; }
+    const CpuTopology& Topology() const { return topology; }
+    int Workers() const { return static_cast<int>(slots.size()); }
+    int Node(int worker) const { return slots[worker % slots.size()].node; }
+    int NodeId(int worker) const { return slots[worker % slots.size()].nodeId; }
+    int Cpu(int worker) const { return slots[worker % slots.size()].cpu; }
+
+    int NodesUsed() const
+    {
+        int maxNode = -1;
+        for (const auto& s : slots)
+            maxNode = std::max(maxNode, s.node);
+        return maxNode + 1;
+    }
+
+    // Pin the calling thread to the worker's CPU / node. Returns false when
+    // placement is disabled or unsupported on this platform.
+    bool Apply(int worker) const
+    {
+        if (policy == Policy::None || slots.empty())
+            return false;
+
+        bool ok = false;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(Cpu(worker), &set);
+        ok = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+#if defined(MC_HAVE_LIBNUMA)
+        if (numa_available() >= 0)
+        { // Keep the CPU pin if it succeeded; otherwise bind to the whole node
+            if (!ok)
+                ok = numa_run_on_node(NodeId(worker)) == 0;
+            numa_set_localalloc();
+        }
+#endif
+        return ok;
+    }
+
+    // Split NSim over the workers: by node (proportional to its workers), then evenly
+    std::vector<int> Partition(int NSim, int workers) const
+    {
+        std::vector<int> shares(workers, 0);
+        if (workers <= 0)
+            return shares;
+        if (policy == Policy::None)
+        { // Plain even split, independent of the topology
+            for (int w = 0; w < workers; ++w)
+                shares[w] = NSim / workers + (w < NSim % workers ? 1 : 0);
+            return shares;
+        }
+
+        int nNodes = 0;
+        for (int w = 0; w < workers; ++w)
+            nNodes = std::max(nNodes, Node(w) + 1);
+
+        std::vector<std::vector<int>> members(nNodes);
+        for (int w = 0; w < workers; ++w)
+            members[Node(w)].push_back(w);
+
+        int assigned = 0, seen = 0;
+        for (int n = 0; n < nNodes; ++n)
+        {
+            if (members[n].empty())
+                continue;
+            seen += static_cast<int>(members[n].size());
+            int nodeTotal = static_cast<int>(static_cast<long long>(NSim) * seen / workers) - assigned;
+            assigned += nodeTotal;
+
+            int m = static_cast<int>(members[n].size());
+            for (int i = 0; i < m; ++i)
+                shares[members[n][i]] = nodeTotal / m + (i < nodeTotal % m ? 1 : 0);
+        }
+        return shares;
+    }
+};
+
+#endif